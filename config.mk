@@ -1,12 +1,15 @@
 MACHINE := qemu-aarch64
 
-SATURN_CONFIG := -DSTACK_SIZE=1024 #-DENABLE_TESTING
+# LOG_LEVEL: messages below this level are removed at build time (0 - log, 1 - info, 2 - error)
+# DEFERRED_LOG: DInfo()/DDbg() messages are stored in binary form, see scripts/log_decode.py
+SATURN_CONFIG := -DSTACK_SIZE=1024 -DIRQ_STACK_SIZE=512 -DMAX_CPUS=4 -DLOG_LEVEL=1 #-DENABLE_TESTING -DDEFERRED_LOG
 
 INCLUDES := -I$(TOP_DIR)/source/include			\
 	    -I$(TOP_DIR)/source/bsp/$(MACHINE)/include
 
 ASMFLAGS := $(SATURN_CONFIG) $(INCLUDES)
-CXXFLAGS := $(SATURN_CONFIG) $(INCLUDES) -MMD -MP -fno-rtti -fno-exceptions
+# Hypervisor doesn't touch FP/SIMD registers, they are switched lazily between guests
+CXXFLAGS := $(SATURN_CONFIG) $(INCLUDES) -MMD -MP -fno-rtti -fno-exceptions -mgeneral-regs-only
 LDFLAGS  :=
 
 
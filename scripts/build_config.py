@@ -19,8 +19,14 @@ def mmap_to_id(name):
         'normal' : 'Normal',
     }[name]
 
-def parse_vm_configuration(partition):
-    content = 'static void VM_Configuration(core::IVirtualMachineConfig& vmConfig)\n'
+# Should be aligned with _max_vms in include/system
+max_partitions = 4
+
+# First shared peripheral INT, lower numbers are private per core
+first_spi = 32
+
+def parse_vm_configuration(partition, index):
+    content = 'static void VM_Configuration_' + str(index) + '(core::IVirtualMachineConfig& vmConfig)\n'
     content += '{\n'
 
     content += '    // IPA memory mapping\n\n'
@@ -45,12 +51,25 @@ def parse_vm_configuration(partition):
     content += partition['entry']
     content += ');\n'
 
+    content += '\n    // CPU core to run the partition\n'
+    content += '    vmConfig.VM_Set_CPU('
+    content += str(partition.get('cpu', 0))
+    content += ');\n'
+
+    if 'idle_trap' in partition:
+        trap = partition['idle_trap']
+        content += '\n    // Trapping of guest WFI and WFE\n'
+        content += '    vmConfig.VM_Set_Idle_Trap('
+        content += ('true' if trap.get('wfi', True) else 'false') + ', '
+        content += ('true' if trap.get('wfe', True) else 'false')
+        content += ');\n'
+
     content += '}\n\n'
 
     return content
 
-def parse_os_storage(partition):
-    content = 'static void OS_Storage_Configuration(OS_Storage& osStorage)\n'
+def parse_os_storage(partition, index):
+    content = 'static void OS_Storage_Configuration_' + str(index) + '(OS_Storage& osStorage)\n'
     content += '{\n'
 
     content += '    // OS storage table\n'
@@ -71,18 +90,103 @@ def parse_os_storage(partition):
 
     return content
 
-def parse_partition(partition):
+def parse_irq_storm(data):
+    content = 'static void IRq_Storm_Configuration(core::IIC& ic)\n'
+    content += '{\n'
+
+    # Storm protection is optional, default policy is used if it's not specified
+    if 'irq_storm' in data:
+        storm = data['irq_storm']
+
+        content += '    // INT storm policy\n'
+        content += '    ic.Set_IRq_Storm_Policy('
+        content += str(storm['window_us']) + ', '
+        content += str(storm['mask_us']) + ', '
+        content += str(storm['overflows'])
+        content += ');\n'
+
+        content += '\n    // INT rate limits\n'
+
+        for limit in storm['limits']:
+            content += '    ic.Set_IRq_Rate_Limit('
+            content += str(limit['nr']) + ', '
+            content += str(limit['max'])
+            content += ');\n'
+
+    content += '}\n\n'
+
+    return content
+
+def parse_partition(partition, index):
     try:
         print ('[GEN]    partition os: ' + partition['system'])
 
-        content = parse_vm_configuration(partition)
-        content += parse_os_storage(partition)
+        content = parse_vm_configuration(partition, index)
+        content += parse_os_storage(partition, index)
 
     except KeyError:
         sys.exit ('error: failed to parse partition cofiguration')
 
     return content
 
+def check_interrupts(partitions):
+    owners = {}
+
+    # Shared INTs can be routed to a single partition only
+    for index, partition in enumerate(partitions):
+        for intr in partition['interrupts']:
+            nr = intr['nr']
+            if nr >= first_spi:
+                if nr in owners and owners[nr] != index:
+                    sys.exit ('error: INT ' + str(nr) + ' is assigned to several partitions')
+                owners[nr] = index
+
+def parse_partition_tables(nr_partitions):
+    content = '// Number of partitions in configuration\n'
+    content += 'static const size_t Nr_Partitions = ' + str(nr_partitions) + ';\n\n'
+
+    content += 'static void (* const VM_Configurations[])(core::IVirtualMachineConfig&) = {\n'
+    for index in range(nr_partitions):
+        content += '    VM_Configuration_' + str(index) + ',\n'
+    content += '};\n\n'
+
+    content += 'static void (* const OS_Storage_Configurations[])(OS_Storage&) = {\n'
+    for index in range(nr_partitions):
+        content += '    OS_Storage_Configuration_' + str(index) + ',\n'
+    content += '};\n\n'
+
+    return content
+
+def parse_schedule(data, partitions):
+    content = 'static void Schedule_Configuration(core::IVirtualMachineSchedule& schedule)\n'
+    content += '{\n'
+
+    # Schedule is optional, each partition gets default time window if it's not specified
+    if 'schedule' in data:
+        sched = data['schedule']
+        ids = [partition.get('id', index) for index, partition in enumerate(partitions)]
+        major_frame = 0
+
+        content += '    // Partition time windows\n'
+
+        for window in sched['windows']:
+            if window['partition'] not in ids:
+                sys.exit ('error: schedule refers to unknown partition ' + str(window['partition']))
+
+            content += '    schedule.Add_Window('
+            content += str(ids.index(window['partition'])) + ', '
+            content += str(window['duration_us'])
+            content += ');\n'
+
+            major_frame += window['duration_us']
+
+        if 'major_frame_us' in sched and sched['major_frame_us'] != major_frame:
+            sys.exit ('error: major frame does not match sum of partition windows')
+
+    content += '}\n\n'
+
+    return content
+
 def parse_input(inputfile):
     content = ''
 
@@ -96,14 +200,31 @@ def parse_input(inputfile):
             sys.exit ('error: cannot find configuration file version')
 
         try:
+            partitions = data['partitions']
             nr_partitions = 0
-            for partition in data['partitions']:
+            for partition in partitions:
+                print('[GEN] parsing partition ' + str(nr_partitions + 1))
+                content += parse_partition(partition, nr_partitions)
                 nr_partitions += 1
-                print('[GEN] parsing partition ' + str(nr_partitions))
-                content += parse_partition(partition)
         except KeyError:
             sys.exit ('error: cannot find partition configuration')
 
+        if nr_partitions == 0 or nr_partitions > max_partitions:
+            sys.exit ('error: unsupported number of partitions: ' + str(nr_partitions))
+
+        check_interrupts(partitions)
+        content += parse_partition_tables(nr_partitions)
+
+        try:
+            content += parse_schedule(data, partitions)
+        except KeyError:
+            sys.exit ('error: failed to parse schedule configuration')
+
+        try:
+            content += parse_irq_storm(data)
+        except KeyError:
+            sys.exit ('error: failed to parse INT storm configuration')
+
     return content
 
 def license_header():
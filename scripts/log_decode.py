@@ -0,0 +1,198 @@
+#!/usr/bin/env python3
+
+# Decoder of Saturn deferred log
+# Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+#
+# Saturn built with DEFERRED_LOG keeps format strings of DInfo()/DDbg() calls in
+# '.dlog' section of saturn.bin, which is not loaded to memory. The records are
+# taken either from console log with the output of 'log dump' command, or from raw
+# memory dump of 'dlog_buffer' symbol, e.g. by QEMU monitor:
+#
+#   (qemu) pmemsave <address> <size> dlog.bin
+#
+# Address and size are printed by '--where' option.
+
+import argparse
+import re
+import struct
+import sys
+
+# Keep in sync with source/core/dlog.hpp
+DLOG_WORDS = 512
+DLOG_MAGIC = 0xd106
+DLOG_MAX_ARGS = 6
+RING_HEADER_SIZE = 64
+RING_SIZE = RING_HEADER_SIZE + DLOG_WORDS * 8
+
+LEVELS = ['log', 'info', 'error', 'none']
+
+# QEMU virt generic timer
+DEFAULT_FREQ = 62500000
+
+class ElfImage:
+    def __init__(self, path):
+        with open(path, 'rb') as f:
+            self.data = f.read()
+
+        if (self.data[:4] != b'\x7fELF') or (self.data[4] != 2):
+            sys.exit('error: %s is not ELF64 file' % path)
+
+        shoff, = struct.unpack_from('<Q', self.data, 0x28)
+        shentsize, shnum, shstrndx = struct.unpack_from('<HHH', self.data, 0x3a)
+
+        self.sections = []
+        for i in range(shnum):
+            name, stype, _, addr, offset, size, link, _, _, entsize = \
+                struct.unpack_from('<IIQQQQIIQQ', self.data, shoff + i * shentsize)
+            self.sections.append((name, stype, addr, offset, size, link, entsize))
+
+        strtab = self.sections[shstrndx]
+        self.names = [self.cstring(strtab[3] + s[0]) for s in self.sections]
+
+    def cstring(self, offset):
+        end = self.data.index(b'\0', offset)
+        return self.data[offset:end].decode(errors='replace')
+
+    def section(self, name):
+        for sname, s in zip(self.names, self.sections):
+            if sname == name:
+                return self.data[s[3]:s[3] + s[4]]
+        return None
+
+    def symbol(self, name):
+        for sname, s in zip(self.names, self.sections):
+            if sname != '.symtab':
+                continue
+            strtab = self.sections[s[5]]
+            for offset in range(s[3], s[3] + s[4], s[6]):
+                st_name, _, _, _, st_value, _ = struct.unpack_from('<IBBHQQ', self.data, offset)
+                if self.cstring(strtab[3] + st_name) == name:
+                    return st_value
+        return None
+
+def format_message(text, args):
+    out = ''
+    i = 0
+    n = 0
+    while i < len(text):
+        c = text[i]
+        if (c != '%') or (i + 1 == len(text)):
+            out += c
+            i += 1
+            continue
+        conv = text[i + 1]
+        i += 2
+        if conv == '%':
+            out += '%'
+            continue
+        value = args[n] if n < len(args) else 0
+        n += 1
+        if conv == 'd':
+            out += str(value - (1 << 64) if value & (1 << 63) else value)
+        elif conv == 'u':
+            out += str(value)
+        elif conv == 'x':
+            out += '%x' % value
+        elif conv == 'c':
+            out += chr(value & 0xff)
+        else:
+            out += '%' + conv
+    return out
+
+def parse_words(words, strings):
+    records = []
+    i = 0
+    while i + 2 <= len(words):
+        header = words[i]
+        fmt_id = header & 0xffffffff
+        nargs = (header >> 32) & 0xf
+        level = (header >> 36) & 0x3
+        cpu = (header >> 40) & 0xff
+
+        # The oldest record could be partially overwritten, so look for the valid header
+        valid = ((header >> 48) == DLOG_MAGIC) and (nargs <= DLOG_MAX_ARGS) and \
+                (i + 2 + nargs <= len(words)) and (fmt_id < len(strings)) and \
+                (strings[fmt_id] != 0) and ((fmt_id == 0) or (strings[fmt_id - 1] == 0))
+        if not valid:
+            i += 1
+            continue
+
+        end = strings.index(b'\0', fmt_id)
+        text = strings[fmt_id:end].decode(errors='replace')
+        records.append((words[i + 1], cpu, level, format_message(text, words[i + 2:i + 2 + nargs])))
+        i += 2 + nargs
+    return records
+
+def parse_log(path, strings):
+    freq = None
+    rings = []
+    with open(path, errors='replace') as f:
+        for line in f:
+            m = re.search(r'dlog: begin freq (\d+)', line)
+            if m:
+                # Only the last dump in the log is decoded
+                freq = int(m.group(1))
+                rings = []
+                continue
+            if re.search(r'dlog: cpu \d+ head \d+', line):
+                rings.append([])
+                continue
+            m = re.search(r'dlog:((?: 0x[0-9a-fA-F]+)+)\s*$', line)
+            if m and rings:
+                rings[-1].extend(int(w, 16) for w in m.group(1).split())
+
+    records = []
+    for words in rings:
+        records.extend(parse_words(words, strings))
+    return freq, records
+
+def parse_raw(path, strings):
+    records = []
+    with open(path, 'rb') as f:
+        data = f.read()
+    for cpu in range(len(data) // RING_SIZE):
+        ring = data[cpu * RING_SIZE:(cpu + 1) * RING_SIZE]
+        head, = struct.unpack_from('<Q', ring, 0)
+        words = []
+        for slot in range(max(0, head - DLOG_WORDS), head):
+            words.append(struct.unpack_from('<Q', ring, RING_HEADER_SIZE + (slot % DLOG_WORDS) * 8)[0])
+        records.extend(parse_words(words, strings))
+    return records
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument('input', nargs='?', help='console log with log dump or raw memory dump (see --raw)')
+    parser.add_argument('-e', '--elf', help='set the path to saturn.bin', default='source/saturn.bin')
+    parser.add_argument('-r', '--raw', help='input is raw memory dump of dlog_buffer', action='store_true')
+    parser.add_argument('-f', '--freq', help='counter frequency for raw dump', type=int, default=DEFAULT_FREQ)
+    parser.add_argument('-c', '--cpus', help='number of CPUs to print dump command for', type=int, default=4)
+    parser.add_argument('-l', '--level', choices=LEVELS[:3], help='minimal level of messages to print', default='log')
+    parser.add_argument('-w', '--where', help='print QEMU command to dump dlog_buffer', action='store_true')
+    args = parser.parse_args()
+
+    elf = ElfImage(args.elf)
+
+    if args.where:
+        addr = elf.symbol('dlog_buffer')
+        if addr is None:
+            sys.exit('error: dlog_buffer is not found, Saturn is built without DEFERRED_LOG')
+        print('pmemsave 0x%x 0x%x dlog.bin' % (addr, RING_SIZE * args.cpus))
+        sys.exit(0)
+
+    if not args.input:
+        parser.error('input file is required')
+
+    strings = elf.section('.dlog')
+    if strings is None:
+        sys.exit('error: .dlog section is not found, Saturn is built without DEFERRED_LOG')
+
+    if args.raw:
+        freq, records = args.freq, parse_raw(args.input, strings)
+    else:
+        freq, records = parse_log(args.input, strings)
+        freq = freq if freq else args.freq
+
+    minimal = LEVELS.index(args.level)
+    for ts, cpu, level, text in sorted(records, key=lambda r: r[0]):
+        if level >= minimal:
+            print('[%12.6f] cpu%d %s: %s' % (ts / freq, cpu, LEVELS[level], text))
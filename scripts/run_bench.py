@@ -0,0 +1,278 @@
+#!/usr/bin/env python3
+
+# End-to-end performance benchmark of Saturn in QEMU
+# Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+#
+# Saturn built with DEFCONFIG=asteroid is started with Asteroid in headless QEMU.
+# QEMU runs with '-icount', so guest time depends only on the number of executed
+# instructions, and the results are reproducible on any build host without special
+# hardware. The console is driven by the script:
+#
+#   irq eoi on, vm start -> Asteroid exit benchmarks -> CTRL+i p -> trace start,
+#   vm resume -> timer ticks -> CTRL+i p -> trace stop, irq stats, trace dump, vm stop
+#
+# Guest exits take the slow path while trace is running, so the trace is started
+# only after the exit benchmarks.
+#
+# QEMU has single CPU, so Asteroid partition is moved to the console core and the
+# console gets the control back when the partition is paused.
+#
+# The metrics are printed in JSON. With '--baseline' they are compared against the
+# stored results (see '--save'), and the script fails if any metric is worse than
+# the threshold.
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+
+from run_qemu import qemu_cmdline
+import trace_decode
+
+PROMPT = '\n$ '
+
+# Console key to enter command mode, see source/core/console.hpp
+CMD_MODE = '\x09'
+
+# Metric name and the direction of improvement, values are printed in this order
+METRICS = [
+    ('boot_us',            'lower'),
+    ('image_load_us',      'lower'),
+    ('exits_per_sec',      'higher'),
+    ('hvc_fast_ns',        'lower'),
+    ('hvc_full_ns',        'lower'),
+    ('mmio_fast_ns',       'lower'),
+    ('mmio_full_ns',       'lower'),
+    ('int_inject_ns',      'lower'),
+    ('int_guest_ns',       'lower'),
+    ('int_guest_p99_ns',   'lower'),
+    ('exit_hyp_ns',        'lower'),
+]
+
+class Console:
+    def __init__(self, cmdline, log):
+        self.text = ''
+        self.pos = 0
+        self.cond = threading.Condition()
+        self.log = log
+        self.qemu = subprocess.Popen(cmdline, stdin=subprocess.PIPE, stdout=subprocess.PIPE,
+                                     stderr=subprocess.STDOUT, bufsize=0)
+        self.reader = threading.Thread(target=self.read, daemon=True)
+        self.reader.start()
+
+    def read(self):
+        while True:
+            data = self.qemu.stdout.read(4096)
+            if not data:
+                break
+            chunk = data.decode(errors='replace').replace('\r', '')
+            self.log.write(chunk)
+            self.log.flush()
+            with self.cond:
+                self.text += chunk
+                self.cond.notify()
+        with self.cond:
+            self.cond.notify()
+
+    def expect(self, pattern, timeout):
+        regex = re.compile(pattern)
+        deadline = time.time() + timeout
+        with self.cond:
+            while True:
+                m = regex.search(self.text, self.pos)
+                if m:
+                    self.pos = m.end()
+                    return m
+                left = deadline - time.time()
+                if (left <= 0) or (not self.reader.is_alive()):
+                    self.stop()
+                    sys.exit('error: timeout while waiting for \'%s\', see %s' % (pattern, self.log.name))
+                self.cond.wait(left)
+
+    def send(self, keys):
+        # Console UART has small RX FIFO, so let's type like a human
+        for c in keys:
+            self.qemu.stdin.write(c.encode())
+            self.qemu.stdin.flush()
+            time.sleep(0.02)
+
+    def command(self, cmd, timeout):
+        self.send(cmd + '\r')
+        self.expect(re.escape(PROMPT), timeout)
+
+    def stop(self):
+        if self.qemu.poll() is None:
+            self.qemu.kill()
+            self.qemu.wait()
+
+def run(args, log):
+    cmdline = qemu_cmdline(args.build, 'asteroid', 1)
+    cmdline.extend(['-icount', 'shift=%d,align=off,sleep=off' % args.shift])
+
+    console = Console(cmdline, log)
+
+    console.expect(r'boot: ready in \d+ us', args.timeout)
+    console.expect(re.escape(PROMPT), args.timeout)
+
+    # Guest EOI time is measured only with maintenance INTs
+    console.command('irq eoi on', args.timeout)
+
+    console.send('vm start\r')
+    console.expect(r'bench: mmio full', args.timeout)
+
+    console.send(CMD_MODE + 'p')
+    console.expect(r'vmm: all VMs paused', args.timeout)
+    console.expect(re.escape(PROMPT), args.timeout)
+
+    console.command('trace start', args.timeout)
+
+    console.send('vm resume\r')
+    for _ in range(args.ticks):
+        console.expect(r'timer: tick \d+\n', args.timeout)
+
+    console.send(CMD_MODE + 'p')
+    console.expect(r'vmm: all VMs paused', args.timeout)
+    console.expect(re.escape(PROMPT), args.timeout)
+
+    console.command('trace stop', args.timeout)
+    console.command('irq stats', args.timeout)
+    console.command('trace dump', args.timeout)
+    console.command('vm stop', args.timeout)
+
+    console.stop()
+
+    return console.text
+
+def parse_irq(text, nr):
+    timings = {}
+    m = re.search(r'\n  INT %d:\n((?:    .*\n)*)' % nr, text)
+    if m:
+        for line in m.group(1).splitlines():
+            t = re.match(r'\s+(\w+)\s+count (\d+)\s+min (\d+)\s+avg (\d+)\s+p99 (\d+)\s+max (\d+) ns', line)
+            if t:
+                timings[t.group(1)] = {'count': int(t.group(2)), 'avg': int(t.group(4)), 'p99': int(t.group(5))}
+    return timings
+
+def parse_trace(path):
+    freq, records = trace_decode.parse_log(path)
+    freq = freq if freq else trace_decode.DEFAULT_FREQ
+    records.sort(key=lambda r: r[0])
+
+    # Time spent in hypervisor between guest exit and the next entry on the core
+    exit_time = {}
+    hyp = []
+    for ts, cpu, event, args in records:
+        if event == 2:
+            exit_time[cpu] = ts
+        elif (event == 1) and (cpu in exit_time):
+            hyp.append(ts - exit_time.pop(cpu))
+
+    return (sum(hyp) * 1000000000) // (freq * len(hyp)) if hyp else None, len(hyp)
+
+def parse(text, logpath, nr):
+    metrics = {}
+    info = {}
+
+    m = re.search(r'boot: ready in (\d+) us', text)
+    metrics['boot_us'] = int(m.group(1))
+
+    images = re.findall(r'OK, (\d+) bytes in (\d+) us', text)
+    metrics['image_load_us'] = sum(int(us) for _, us in images)
+    info['image_bytes'] = sum(int(size) for size, _ in images)
+
+    for name, ns in re.findall(r'bench: (\w+ \w+)\s+(\d+) ns per round trip', text):
+        metrics[name.replace(' ', '_') + '_ns'] = int(ns)
+
+    # Guest exits handled by the fast path back to back
+    if metrics.get('hvc_fast_ns'):
+        metrics['exits_per_sec'] = 1000000000 // metrics['hvc_fast_ns']
+
+    timings = parse_irq(text, nr)
+    if 'inject' in timings:
+        metrics['int_inject_ns'] = timings['inject']['avg']
+    if 'guest' in timings:
+        metrics['int_guest_ns'] = timings['guest']['avg']
+        metrics['int_guest_p99_ns'] = timings['guest']['p99']
+    info['int'] = nr
+    info['int_count'] = timings['guest']['count'] if 'guest' in timings else 0
+
+    hyp_ns, exits = parse_trace(logpath)
+    if hyp_ns is not None:
+        metrics['exit_hyp_ns'] = hyp_ns
+    info['trace_exits'] = exits
+
+    return {name: metrics[name] for name, _ in METRICS if name in metrics}, info
+
+def compare(metrics, baseline, threshold):
+    result = {}
+    regressions = []
+
+    for name, better in METRICS:
+        if (name not in metrics) or (not baseline.get(name)):
+            continue
+
+        change = (metrics[name] - baseline[name]) * 100.0 / baseline[name]
+        worse = change if better == 'lower' else -change
+
+        if worse > threshold:
+            status = 'regression'
+            regressions.append(name)
+        elif worse < -threshold:
+            status = 'improvement'
+        else:
+            status = 'ok'
+
+        result[name] = {'baseline': baseline[name], 'change_pct': round(change, 2), 'status': status}
+
+    return result, regressions
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument('-b', '--build', help='set the path to build directory', default=os.getcwd())
+    parser.add_argument('-B', '--baseline', help='compare the results against baseline JSON file')
+    parser.add_argument('-s', '--save', help='save the results as baseline JSON file')
+    parser.add_argument('-t', '--threshold', help='allowed degradation against baseline in percents', type=float, default=5.0)
+    parser.add_argument('-l', '--log', help='save console log to the file')
+    parser.add_argument('-i', '--int', help='INT to report delivery latency for', type=int, default=27)
+    parser.add_argument('-n', '--ticks', help='number of Asteroid timer ticks to trace', type=int, default=3)
+    parser.add_argument('--shift', help='QEMU icount shift, guest runs at 10^9 / 2^shift instructions per second', type=int, default=0)
+    parser.add_argument('--timeout', help='host time limit of each step in seconds', type=int, default=120)
+    args = parser.parse_args()
+
+    if args.log:
+        log = open(args.log, 'w')
+    else:
+        log = tempfile.NamedTemporaryFile('w', prefix='saturn_bench_', suffix='.log', delete=False)
+
+    text = run(args, log)
+    log.close()
+
+    metrics, info = parse(text, log.name, args.int)
+
+    results = {'metrics': metrics, 'info': info, 'icount_shift': args.shift}
+    regressions = []
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+        if baseline.get('icount_shift') != args.shift:
+            sys.exit('error: baseline was taken with different icount shift')
+        results['comparison'], regressions = compare(metrics, baseline['metrics'], args.threshold)
+
+    if args.save:
+        with open(args.save, 'w') as f:
+            json.dump({'metrics': metrics, 'icount_shift': args.shift}, f, indent=2)
+            f.write('\n')
+
+    print(json.dumps(results, indent=2))
+
+    if not args.log:
+        os.unlink(log.name)
+
+    if regressions:
+        sys.exit('error: regression in ' + ', '.join(regressions))
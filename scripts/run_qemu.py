@@ -7,14 +7,14 @@ import argparse
 import os
 import subprocess
 
-def start_qemu(topfolder, os, extraparams):
+def qemu_cmdline(topfolder, os, cpus=4):
     # QEMU command
     cmdline = (['qemu-system-aarch64'])
     cmdline.extend(['-machine', 'virt,gic_version=3'])
     cmdline.extend(['-machine', 'virtualization=true'])
     cmdline.extend(['-machine', 'type=virt'])
     cmdline.extend(['-cpu', 'cortex-a57'])                  # Use ARMv8 64-bit
-    cmdline.extend(['-smp', '4'])                           # Use SMP with 4 cores
+    cmdline.extend(['-smp', str(cpus)])                     # Use SMP with 4 cores by default
     cmdline.extend(['-m', '1024M'])                         # Use 1GB of RAM
     cmdline.extend(['-nographic'])                          # Only console output
 
@@ -33,6 +33,10 @@ def start_qemu(topfolder, os, extraparams):
         #cmdline.extend(['-drive', 'id=disk0,file=images/core-image-minimal-qemuarm64.ext4,if=none,format=raw'])
         #cmdline.extend(['-device', 'virtio-scsi,drive=disk0'])
 
+    return cmdline
+
+def start_qemu(topfolder, os, extraparams):
+    cmdline = qemu_cmdline(topfolder, os)
     cmdline.extend([extraparams])
 
     print(cmdline)
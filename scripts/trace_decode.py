@@ -0,0 +1,187 @@
+#!/usr/bin/env python3
+
+# Decoder of Saturn binary event trace
+# Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+#
+# Trace is taken either from console log with the output of 'trace dump' command,
+# or from raw memory dump of 'trace_buffer' symbol, e.g. by QEMU monitor:
+#
+#   (qemu) pmemsave <address> <size> trace.bin
+#
+# Address and size are printed by '--where' option. Symbols of hypervisor addresses
+# are resolved by saturn.map which is generated by the build.
+
+import argparse
+import bisect
+import re
+import struct
+import sys
+
+# Keep in sync with source/include/core/itrace
+EVENTS = {
+    1: ('guest_enter', ['vm', 'pc']),
+    2: ('guest_exit',  ['ec', 'esr', 'pc']),
+    3: ('mmio_trap',   ['ipa', 'reg', 'width', 'write']),
+    4: ('irq_ack',     ['int', 'guest', 'handler']),
+    5: ('lr_inject',   ['vm', 'int', 'lr', 'hw']),
+    6: ('maintenance', ['eisr']),
+    7: ('vm_state',    ['from', 'to']),
+    8: ('mmu_map',     ['stage', 'va', 'pa', 'size']),
+    9: ('mmu_unmap',   ['stage', 'va', 'size']),
+}
+
+# Arguments which are printed in decimal
+DECIMAL_ARGS = ['vm', 'reg', 'width', 'write', 'int', 'guest', 'lr', 'hw']
+
+EXCEPTION_CLASSES = {
+    0x01: 'wfx',
+    0x07: 'fp_access',
+    0x16: 'hvc64',
+    0x17: 'smc64',
+    0x18: 'sysreg',
+    0x20: 'iabt_low',
+    0x24: 'dabt_low',
+    0x40: 'irq',
+}
+
+VM_STATES = ['starting', 'running', 'request_pause', 'paused', 'request_shutdown', 'stopped', 'error']
+
+# Keep in sync with source/core/trace.hpp
+TRACE_RECORDS = 512
+ENTRY_FORMAT = '<QHBBI4Q'
+ENTRY_SIZE = struct.calcsize(ENTRY_FORMAT)
+RING_HEADER_SIZE = 64
+RING_SIZE = RING_HEADER_SIZE + TRACE_RECORDS * ENTRY_SIZE
+
+# QEMU virt generic timer
+DEFAULT_FREQ = 62500000
+
+class SymbolMap:
+    def __init__(self, path):
+        self.addrs = []
+        self.names = []
+
+        symbols = {}
+        if path:
+            pattern = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+([A-Za-z_.$][^=]*?)(\s+=\s+.*)?$')
+            with open(path, errors='replace') as f:
+                for line in f:
+                    m = pattern.match(line)
+                    if m:
+                        symbols[int(m.group(1), 16)] = m.group(2).strip()
+
+        for addr in sorted(symbols):
+            self.addrs.append(addr)
+            self.names.append(symbols[addr])
+
+    def lookup(self, name):
+        for addr, sym in zip(self.addrs, self.names):
+            if sym == name:
+                return addr
+        return None
+
+    def resolve(self, addr):
+        i = bisect.bisect_right(self.addrs, addr) - 1
+        if (i < 0) or (addr == 0):
+            return None
+        offset = addr - self.addrs[i]
+        return self.names[i] + ('+0x%x' % offset if offset else '')
+
+def parse_log(path):
+    freq = None
+    records = []
+    pattern = re.compile(r'trace: (\d+) (\d+) (0x[0-9a-fA-F]+)((?: 0x[0-9a-fA-F]+){4})')
+    with open(path, errors='replace') as f:
+        for line in f:
+            m = re.search(r'trace: begin freq (\d+)', line)
+            if m:
+                # Only the last dump in the log is decoded
+                freq = int(m.group(1))
+                records = []
+                continue
+            m = pattern.search(line)
+            if m:
+                args = [int(a, 16) for a in m.group(4).split()]
+                records.append((int(m.group(3), 16), int(m.group(1)), int(m.group(2)), args))
+    return freq, records
+
+def parse_raw(path):
+    records = []
+    with open(path, 'rb') as f:
+        data = f.read()
+    for cpu in range(len(data) // RING_SIZE):
+        ring = data[cpu * RING_SIZE:(cpu + 1) * RING_SIZE]
+        head = struct.unpack_from('<Q', ring, 0)[0]
+        for slot in range(max(0, head - TRACE_RECORDS), head):
+            offset = RING_HEADER_SIZE + (slot % TRACE_RECORDS) * ENTRY_SIZE
+            ts, event, rcpu, _, seq, a0, a1, a2, a3 = struct.unpack_from(ENTRY_FORMAT, ring, offset)
+            # Record is being written or was already overwritten
+            if seq != ((slot + 1) & 0xffffffff):
+                continue
+            records.append((ts, rcpu, event, [a0, a1, a2, a3]))
+    return records
+
+def format_arg(event, name, value, symbols):
+    if (name == 'ec'):
+        return 'ec=%s' % EXCEPTION_CLASSES.get(value, '0x%x' % value)
+    if (name in ['from', 'to']) and (value < len(VM_STATES)):
+        return '%s=%s' % (name, VM_STATES[value])
+    if (name == 'stage'):
+        return 'stage=%d' % (2 if value else 1)
+    if (name == 'handler'):
+        sym = symbols.resolve(value)
+        return 'handler=%s' % (sym if sym else '0x%x' % value)
+    if (name in DECIMAL_ARGS):
+        return '%s=%d' % (name, value)
+    return '%s=0x%x' % (name, value)
+
+def decode(records, freq, symbols):
+    records.sort(key=lambda r: r[0])
+    if not records:
+        print('no trace records')
+        return
+
+    start = records[0][0]
+    exit_time = {}
+
+    for ts, cpu, event, args in records:
+        name, arg_names = EVENTS.get(event, ('event%d' % event, ['a0', 'a1', 'a2', 'a3']))
+        text = ' '.join(format_arg(event, n, v, symbols) for n, v in zip(arg_names, args))
+
+        # Time spent in hypervisor between guest exit and the next entry on the core
+        if (name == 'guest_exit'):
+            exit_time[cpu] = ts
+        elif (name == 'guest_enter') and (cpu in exit_time):
+            text += ' (hyp %.3f us)' % ((ts - exit_time.pop(cpu)) * 1000000.0 / freq)
+
+        print('%12.3f us  cpu%d  %-12s %s' % ((ts - start) * 1000000.0 / freq, cpu, name, text))
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument('input', nargs='?', help='console log with trace dump or raw memory dump (see --raw)')
+    parser.add_argument('-m', '--map', help='set the path to saturn.map to resolve symbols', default='')
+    parser.add_argument('-r', '--raw', help='input is raw memory dump of trace_buffer', action='store_true')
+    parser.add_argument('-f', '--freq', help='counter frequency for raw dump', type=int, default=DEFAULT_FREQ)
+    parser.add_argument('-c', '--cpus', help='number of CPUs to print dump command for', type=int, default=4)
+    parser.add_argument('-w', '--where', help='print QEMU command to dump trace_buffer', action='store_true')
+    args = parser.parse_args()
+
+    symbols = SymbolMap(args.map)
+
+    if args.where:
+        addr = symbols.lookup('trace_buffer')
+        if addr is None:
+            sys.exit('error: trace_buffer is not found, please set the path to saturn.map')
+        print('pmemsave 0x%x 0x%x trace.bin' % (addr, RING_SIZE * args.cpus))
+        sys.exit(0)
+
+    if not args.input:
+        parser.error('input file is required')
+
+    if args.raw:
+        freq, records = args.freq, parse_raw(args.input)
+    else:
+        freq, records = parse_log(args.input)
+        freq = freq if freq else args.freq
+
+    decode(records, freq, symbols)
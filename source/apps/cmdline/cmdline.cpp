@@ -12,7 +12,12 @@
 
 #include "cmdline.hpp"
 
+#include <arm64/registers>
 #include <core/iconsole>
+#include <core/idlog>
+#include <core/iic>
+#include <core/itrace>
+#include <core/ivirtic>
 #include <core/ivmm>
 
 namespace saturn {
@@ -85,21 +90,9 @@ void CommandLine::Start_Loop(void)
 bool CommandLine::Parse_Command(char* cmdInput)
 {
 	bool doQuit = false;
-	size_t n = 0;
-
-	while (cmdInput[n] != 0)
-	{
-		if (cmdInput[n] == ' ')
-		{
-			cmdInput[n++] = 0;
-			break;
-		}
-
-		n++;
-	}
 
 	char* cmdName = cmdInput;
-	char* cmdArgs = &cmdInput[n];
+	char* cmdArgs = Split_Args(cmdInput);
 
 	// Now we have:
 	//  * cmdName is the command itself which should be parsed
@@ -123,9 +116,26 @@ bool CommandLine::Parse_Command(char* cmdInput)
 	}
 	else
 #endif // ENABLE_TESTING
+#ifdef DEFERRED_LOG
+	if (Str_Cmp(cmdName, "log"))
+	{
+		Do_Log(cmdArgs);
+	}
+	else
+#endif // DEFERRED_LOG
 	if (Str_Cmp(cmdName, "vm"))
 	{
-		Do_Vm(cmdArgs);
+		doQuit = Do_Vm(cmdArgs);
+	}
+	else
+	if (Str_Cmp(cmdName, "irq"))
+	{
+		Do_Irq(cmdArgs);
+	}
+	else
+	if (Str_Cmp(cmdName, "trace"))
+	{
+		Do_Trace(cmdArgs);
 	}
 	else
 	{
@@ -163,14 +173,60 @@ bool CommandLine::Str_Cmp(const char* firstLine, const char* secondLine)
 	return retVal;
 }
 
+bool CommandLine::Str_To_Num(const char* line, uint64_t& num)
+{
+	bool retVal = (line[0] != 0);
+	size_t n = 0;
+
+	num = 0;
+
+	while (retVal && (line[n] != 0))
+	{
+		if ((line[n] >= '0') && (line[n] <= '9'))
+		{
+			num = num * 10 + (line[n++] - '0');
+		}
+		else
+		{
+			retVal = false;
+		}
+	}
+
+	return retVal;
+}
+
+char* CommandLine::Split_Args(char* line)
+{
+	size_t n = 0;
+
+	while (line[n] != 0)
+	{
+		if (line[n] == ' ')
+		{
+			line[n++] = 0;
+			break;
+		}
+
+		n++;
+	}
+
+	// Return the rest of line after the first word
+	return &line[n];
+}
+
 void CommandLine::Do_Help(void)
 {
 	Raw() << "Saturn Hypervisor console, please use the following commands:" << fmt::endl;
 	Raw() << "  help        - display usage information" << fmt::endl;
+	Raw() << "  irq         - interrupt latency statistics" << fmt::endl;
+#ifdef DEFERRED_LOG
+	Raw() << "  log         - deferred log" << fmt::endl;
+#endif // DEFERRED_LOG
 	Raw() << "  quit        - stop console application" << fmt::endl;
 #ifdef ENABLE_TESTING
 	Raw() << "  test        - test adapter to run smoke tests" << fmt::endl;
 #endif // ENABLE_TESTING
+	Raw() << "  trace       - binary event trace" << fmt::endl;
 	Raw() << "  vm          - virtual machine management" << fmt::endl;
 	Raw() << fmt::endl;
 }
@@ -197,15 +253,180 @@ void CommandLine::Do_Test_Adapter(const char* args)
 }
 #endif // ENABLE_TESTING
 
-void CommandLine::Do_Vm(const char* args)
+#ifdef DEFERRED_LOG
+void CommandLine::Do_Log(const char* args)
+{
+	if (Str_Cmp(args, "dump"))
+	{
+		DLog_Dump();
+	}
+	else
+	{
+		Raw() << "error: 'log' arguments missed, please use 'dump' to print deferred log" << fmt::endl;
+	}
+
+	Raw() << fmt::endl;
+}
+#endif // DEFERRED_LOG
+
+bool CommandLine::Do_Vm(const char* args)
 {
+	bool doQuit = false;
+
 	if (Str_Cmp(args, "start"))
 	{
 		iVMM().Start_VM();
 	}
 	else
+	if (Str_Cmp(args, "resume"))
+	{
+		iVMM().Resume_VM();
+	}
+	else
+	if (Str_Cmp(args, "stop"))
+	{
+		iVMM().Stop_VM();
+	}
+	else
+	{
+		Raw() << "error: 'vm' arguments missed, please use 'start', 'resume' or 'stop'" << fmt::endl;
+	}
+
+	// Partitions are running on other CPU cores, so console follows them. Local
+	// partitions return here when they are paused or stopped.
+	vm_state state = iVMM().Get_VM_State();
+	doQuit = (vm_state::starting == state) || (vm_state::running == state);
+
+	Raw() << fmt::endl;
+
+	return doQuit;
+}
+
+static void Print_Timing(const char* name, const lib::Histogram& h, uint64_t freq)
+{
+	// Counter ticks to nanoseconds
+	auto ns = [freq](uint64_t ticks) -> uint64_t { return (ticks * 1000000000) / freq; };
+
+	Raw() << "    " << name << "\tcount " << h.Count()
+	      << "\tmin " << ns(h.Min()) << "\tavg " << ns(h.Avg())
+	      << "\tp99 " << ns(h.Percentile(99)) << "\tmax " << ns(h.Max()) << " ns" << fmt::endl;
+}
+
+void CommandLine::Do_Irq(char* args)
+{
+	char* subArgs = Split_Args(args);
+
+	if (Str_Cmp(args, "") || Str_Cmp(args, "stats"))
+	{
+		uint64_t freq = ReadArm64Reg(CNTFRQ_EL0);
+		uint64_t budget = iIC().Get_IRq_Budget();
+		const IRq_Timing* t = iIC().Get_IRq_Timing(0);
+
+		Raw() << "Maintenance INTs: " << iVirtIC().Get_Maintenance_Count() << " ("
+		      << iVirtIC().Get_Maintenance_Rate() << " per second)" << fmt::endl;
+		Raw() << "INT timings, handler budget " << budget << " us:" << fmt::endl;
+
+		for (size_t i = 1; nullptr != t; i++)
+		{
+			Raw() << "  INT " << t->nr << ":" << fmt::endl;
+
+			if (t->handler.Count() > 0)
+			{
+				Print_Timing("handler", t->handler, freq);
+			}
+
+			if (t->inject.Count() > 0)
+			{
+				Print_Timing("inject ", t->inject, freq);
+			}
+
+			if (t->guest.Count() > 0)
+			{
+				Print_Timing("guest  ", t->guest, freq);
+			}
+
+			if (t->overruns > 0)
+			{
+				Raw() << "    ! handler exceeded the budget " << t->overruns << " time(s)" << fmt::endl;
+			}
+
+			t = iIC().Get_IRq_Timing(i);
+		}
+	}
+	else
+	if (Str_Cmp(args, "storm"))
+	{
+		const IRq_Stats& stats = iIC().Get_IRq_Stats();
+		const IRq_Rate* r = iIC().Get_IRq_Rate(0);
+
+		Raw() << "INT rate limits, " << stats.coalesced << " software INT(s) coalesced:" << fmt::endl;
+
+		for (size_t i = 1; nullptr != r; i++)
+		{
+			Raw() << "  INT " << r->nr << "\tlimit " << r->limit << "\ttotal " << r->total
+			      << "\tthrottled " << r->throttled << (r->masked ? "\t(masked)" : "") << fmt::endl;
+
+			r = iIC().Get_IRq_Rate(i);
+		}
+	}
+	else
+	if (Str_Cmp(args, "reset"))
+	{
+		iIC().Reset_IRq_Timing();
+	}
+	else
+	if (Str_Cmp(args, "eoi"))
+	{
+		if (Str_Cmp(subArgs, "on") || Str_Cmp(subArgs, "off"))
+		{
+			iVirtIC().Track_Guest_EOI(Str_Cmp(subArgs, "on"));
+		}
+		else
+		{
+			Raw() << "error: 'irq eoi' requires 'on' or 'off'" << fmt::endl;
+		}
+	}
+	else
+	if (Str_Cmp(args, "budget"))
+	{
+		uint64_t us;
+
+		if (Str_To_Num(subArgs, us))
+		{
+			iIC().Set_IRq_Budget(us);
+		}
+		else
+		{
+			Raw() << "error: 'irq budget' requires the value in microseconds" << fmt::endl;
+		}
+	}
+	else
+	{
+		Raw() << "error: unknown 'irq' arguments, please use 'stats', 'storm', 'reset', 'eoi on|off' or 'budget <us>'" << fmt::endl;
+	}
+
+	Raw() << fmt::endl;
+}
+
+void CommandLine::Do_Trace(const char* args)
+{
+	if (Str_Cmp(args, "start"))
+	{
+		Trace_Start();
+	}
+	else
+	if (Str_Cmp(args, "stop"))
+	{
+		Trace_Stop();
+	}
+	else
+	if (Str_Cmp(args, "dump"))
+	{
+		Trace_Dump();
+	}
+	else
 	{
-		Raw() << "error: 'vm' arguments missed, please use 'start' to run guest VM" << fmt::endl;
+		Raw() << "error: 'trace' arguments missed, please use 'start', 'stop' or 'dump'" << fmt::endl;
 	}
 
 	Raw() << fmt::endl;
@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <basetypes>
+
 namespace saturn {
 namespace apps {
 
@@ -26,17 +28,26 @@ public:
 private:
 	bool Parse_Command(char*);
 	bool Str_Cmp(const char*, const char*);
+	bool Str_To_Num(const char*, uint64_t&);
+	char* Split_Args(char*);
 
 // Commands
 private:
 	void Do_Help(void);
 	void Do_Bad_Command(void);
-	void Do_Vm(const char*);
+	bool Do_Vm(const char*);
+	void Do_Irq(char*);
+	void Do_Trace(const char*);
 
 #ifdef ENABLE_TESTING
 private:
 	void Do_Test_Adapter(const char*);
 #endif // ENABLE_TESTING
+
+#ifdef DEFERRED_LOG
+private:
+	void Do_Log(const char*);
+#endif // DEFERRED_LOG
 };
 
 }; // namespace apps
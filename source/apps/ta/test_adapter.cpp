@@ -17,18 +17,33 @@
 #include <core/iheap>
 #include <core/iic>
 #include <core/immu>
+#include <core/itimer>
+#include <core/iwork>
 
+#include <lib/bitmap>
+#include <lib/hashmap>
+#include <lib/histogram>
+#include <lib/ilist>
 #include <lib/list>
+#include <lib/vector>
 
+#include <arm64/atomic>
+#include <arm64/registers>
 #include <io>
 #include <ringbuffer>
+#include <sync/spinlock>
 
 namespace saturn {
+
+// External API:
+namespace core {
+	bool SMP_Call(size_t cpu, void (*func)(void*), void* arg);
+};
+
 namespace apps {
 
 using namespace core;
 
-
 // INT test data
 static const uint32_t _testINT = 10;
 static uint32_t valueINT = 0;
@@ -61,6 +76,156 @@ static bool INT_Smoke_Test(void)
 	return ret;
 }
 
+// INT batching test data
+static const uint32_t _batchINTs[] = {11, 12, 13};
+static const size_t _nrBatchINTs = sizeof(_batchINTs) / sizeof(_batchINTs[0]);
+static uint32_t batchCount = 0;
+
+static void SGI_Batch_Handler(uint32_t id)
+{
+	batchCount++;
+}
+
+static bool INT_Batch_Test(void)
+{
+	Log() << "  /send " << _nrBatchINTs << " SGIs while INTs are masked" << fmt::endl;
+
+	for (size_t i = 0; i < _nrBatchINTs; i++)
+	{
+		iIC().Register_IRq_Handler(_batchINTs[i], SGI_Batch_Handler);
+	}
+
+	uint64_t exceptions = iIC().Get_IRq_Stats().exceptions;
+
+	iIC().Local_IRq_Disable();
+
+	for (size_t i = 0; i < _nrBatchINTs; i++)
+	{
+		iIC().Send_SGI(1, _batchINTs[i]);
+	}
+
+	// All the pending SGIs should be drained by single exception
+	iIC().Local_IRq_Enable();
+
+	exceptions = iIC().Get_IRq_Stats().exceptions - exceptions;
+	Log() << "    <- " << batchCount << " INTs handled by " << exceptions << " exception(s)" << fmt::endl;
+
+	bool ret;
+
+	if ((_nrBatchINTs == batchCount) && (1 == exceptions))
+	{
+		ret = true;
+		Info() << "ta: " << __func__ << ": PASSED" << fmt::endl;
+	}
+	else
+	{
+		ret = false;
+		Info() << "ta: " << __func__ << ": FAILED" << fmt::endl;
+	}
+
+	return ret;
+}
+
+// INT preemption test data
+static const uint32_t _slowINT = 14;
+static const uint32_t _fastINT = 15;
+static uint64_t fastSent = 0;
+static uint64_t fastLatency = 0;
+static uint64_t slowDuration = 0;
+
+static void SGI_Slow_Handler(uint32_t id)
+{
+	uint64_t start = ReadArm64Reg(CNTPCT_EL0);
+	uint64_t ticks = ReadArm64Reg(CNTFRQ_EL0) / 1000;
+
+	// Raise INT with higher priority while the handler is running
+	fastSent = start;
+	iIC().Send_SGI(1, _fastINT);
+
+	// Emulate 1ms long handler
+	while ((ReadArm64Reg(CNTPCT_EL0) - start) < ticks);
+
+	slowDuration = ReadArm64Reg(CNTPCT_EL0) - start;
+}
+
+static void SGI_Fast_Handler(uint32_t id)
+{
+	fastLatency = ReadArm64Reg(CNTPCT_EL0) - fastSent;
+}
+
+static bool INT_Preemption_Test(void)
+{
+	Log() << "  /send guest priority SGI from long running hypervisor handler" << fmt::endl;
+
+	iIC().Register_IRq_Handler(_slowINT, SGI_Slow_Handler);
+	iIC().Register_IRq_Handler(_fastINT, SGI_Fast_Handler);
+	iIC().Set_IRq_Priority(_slowINT, IRqPriority::Default);
+	iIC().Set_IRq_Priority(_fastINT, IRqPriority::Guest);
+
+	iIC().Send_SGI(1, _slowINT);
+
+	Log() << "    <- delivery latency = " << fastLatency << " ticks, handler duration = "
+	      << slowDuration << " ticks" << fmt::endl;
+
+	bool ret;
+
+	// Delivery latency should not be bounded by the slow handler
+	if ((slowDuration != 0) && (fastLatency < slowDuration))
+	{
+		ret = true;
+		Info() << "ta: " << __func__ << ": PASSED" << fmt::endl;
+	}
+	else
+	{
+		ret = false;
+		Info() << "ta: " << __func__ << ": FAILED" << fmt::endl;
+	}
+
+	return ret;
+}
+
+static bool INT_Timing_Test(void)
+{
+	Log() << "  /look for timings of INT(" << _slowINT << ")" << fmt::endl;
+
+	const IRq_Timing* timing = nullptr;
+	const IRq_Timing* t = iIC().Get_IRq_Timing(0);
+
+	for (size_t i = 1; nullptr != t; i++)
+	{
+		if (_slowINT == t->nr)
+		{
+			timing = t;
+		}
+
+		t = iIC().Get_IRq_Timing(i);
+	}
+
+	bool ret = false;
+
+	if (nullptr != timing)
+	{
+		Log() << "    <- handler count = " << timing->handler.Count() << ", max = " << timing->handler.Max()
+		      << " ticks, p99 = " << timing->handler.Percentile(99) << " ticks" << fmt::endl;
+
+		// Slow handler takes about 1ms, so it should be recorded and exceed the default budget
+		ret = (timing->handler.Count() > 0) &&
+		      (timing->handler.Max() >= slowDuration) &&
+		      (timing->overruns > 0);
+	}
+
+	if (ret)
+	{
+		Info() << "ta: " << __func__ << ": PASSED" << fmt::endl;
+	}
+	else
+	{
+		Info() << "ta: " << __func__ << ": FAILED" << fmt::endl;
+	}
+
+	return ret;
+}
+
 static bool CPU_Smoke_Test(void)
 {
 	uint16_t cpu_id = iCPU().Id();
@@ -141,6 +306,81 @@ static bool RINGBUFFER_Smoke_Test(void)
 	return ret;
 }
 
+// Number of elements passed through ring buffer to measure the throughput
+static const size_t _ringBenchSize = 4096;
+
+static bool RINGBUFFER_Bulk_Test(void)
+{
+	uint32_t data[10];
+	uint32_t out[10];
+	bool ret = true;
+
+	for (uint32_t i = 0; i < 10; i++)
+	{
+		data[i] = i;
+	}
+
+	Log() << "/bulk operations on ring buffer with size which is not power of 2" << fmt::endl;
+	RingBuffer<uint32_t, 6> buf(rb::full_ignore);
+
+	// Second bulk put wraps around the end of buffer
+	ret = ret && (buf.In(data, 4) == 4) && (buf.Out(out, 3) == 3);
+	ret = ret && (buf.In(data + 4, 6) == 5) && (buf.Out(out, 10) == 6);
+
+	for (uint32_t i = 0; ret && (i < 6); i++)
+	{
+		ret = (out[i] == i + 3);
+	}
+
+	Log() << "/bulk put to ring buffer with data overwrite" << fmt::endl;
+	RingBuffer<uint32_t, 4> obuf(rb::full_overwrite);
+
+	ret = ret && (obuf.In(data, 10) == 10) && (obuf.Out(out, 10) == 4) && (out[0] == 6) && (out[3] == 9);
+
+	Log() << "/lock-free SPSC ring buffer" << fmt::endl;
+	SPSC_RingBuffer<uint32_t, 8> sbuf;
+	uint32_t val = 0;
+
+	ret = ret && (sbuf.In(data, 10) == 8) && (false == sbuf.In(data[0]));
+	ret = ret && sbuf.Out(val) && (val == 0) && (sbuf.Out(out, 10) == 7) && (out[6] == 7) && sbuf.Empty();
+
+	// Element by element vs bulk throughput of locked ring buffer
+	RingBuffer<uint32_t, 64> tbuf(rb::full_ignore);
+	uint64_t freq = ReadArm64Reg(CNTFRQ_EL0);
+	uint64_t start = Read_Counter();
+
+	for (size_t i = 0; i < _ringBenchSize; i++)
+	{
+		tbuf.In(data[0]);
+		tbuf.Out(val);
+	}
+
+	uint64_t single = Read_Counter() - start;
+	start = Read_Counter();
+
+	for (size_t i = 0; i < _ringBenchSize; i += 8)
+	{
+		tbuf.In(data, 8);
+		tbuf.Out(out, 8);
+	}
+
+	uint64_t bulk = Read_Counter() - start;
+
+	Info() << "  /ring in/out: " << (single * 1000000000 / freq / _ringBenchSize) << " ns per element, "
+	       << (bulk * 1000000000 / freq / _ringBenchSize) << " ns per element in bulk" << fmt::endl;
+
+	if (ret)
+	{
+		Info() << "ta: " << __func__ << ": PASSED" << fmt::endl;
+	}
+	else
+	{
+		Info() << "ta: " << __func__ << ": FAILED" << fmt::endl;
+	}
+
+	return ret;
+}
+
 static bool MMU_Smoke_Test(void)
 {
 	uint64_t pa  = 0x41000000;
@@ -259,16 +499,428 @@ static void LIST_Smoke_Test(void)
 	list.push_back(10);
 }
 
+struct IList_Item
+{
+	lib::IList_Hook hook;
+	int val;
+};
+
+static bool ILIST_Smoke_Test(void)
+{
+	IList_Item items[3] = {{lib::IList_Hook(), 1}, {lib::IList_Hook(), 2}, {lib::IList_Hook(), 3}};
+	lib::IList<IList_Item, &IList_Item::hook> list;
+	bool ret = true;
+
+	Log() << "/link items to list" << fmt::endl;
+	for (size_t i = 0; i < 3; i++)
+	{
+		list.push_back(items[i]);
+	}
+
+	Log() << "/unlink middle item, then double unlink" << fmt::endl;
+	list.remove(items[1]);
+	list.remove(items[1]);
+
+	int sum = 0;
+	for (auto it = list.begin(); it != list.end(); ++it)
+	{
+		sum += it->val;
+	}
+
+	if ((2 != list.size()) || (4 != sum) || items[1].hook.linked())
+	{
+		ret = false;
+	}
+
+	Log() << "/pop items" << fmt::endl;
+	if ((&items[0] != list.pop_front()) || (&items[2] != list.pop_front()) ||
+	    (nullptr != list.pop_front()) || !list.empty())
+	{
+		ret = false;
+	}
+
+	if (ret)
+	{
+		Info() << "ta: " << __func__ << ": PASSED" << fmt::endl;
+	}
+	else
+	{
+		Info() << "ta: " << __func__ << ": FAILED" << fmt::endl;
+	}
+
+	return ret;
+}
+
+static bool CONTAINERS_Smoke_Test(void)
+{
+	lib::Bitmap<200> bitmap;
+	lib::HashMap<uint32_t, uint32_t, 16> map;
+	lib::StaticVector<uint32_t, 4> vector;
+	bool ret = true;
+
+	Log() << "/bitmap range crossing the words" << fmt::endl;
+	bitmap.set_range(60, 10);
+	bitmap.set(199);
+	bitmap.clear(65);
+
+	if ((10 != bitmap.count()) || (60 != bitmap.find_first()) || (66 != bitmap.find_next(65)) ||
+	    (199 != bitmap.find_next(70)) || (65 != bitmap.find_next_zero(60)) || (200 != bitmap.find_next(200)))
+	{
+		ret = false;
+	}
+
+	Log() << "/hash map with colliding keys" << fmt::endl;
+	for (uint32_t key = 0; key < 16; key++)
+	{
+		map.insert(key * 16, key);
+	}
+
+	if (map.insert(1000, 0) || !map.erase(32) || (nullptr != map.find(32)) || (15 != map.size()))
+	{
+		ret = false;
+	}
+
+	for (uint32_t key = 0; key < 16; key++)
+	{
+		uint32_t* val = map.find(key * 16);
+
+		if ((2 != key) && ((nullptr == val) || (key != *val)))
+		{
+			ret = false;
+		}
+	}
+
+	Log() << "/static vector overflow and erase" << fmt::endl;
+	for (uint32_t i = 0; i < 5; i++)
+	{
+		vector.push_back(i);
+	}
+
+	vector.erase(0);
+
+	if ((3 != vector.size()) || (1 != vector[0]) || (3 != vector[2]))
+	{
+		ret = false;
+	}
+
+	if (ret)
+	{
+		Info() << "ta: " << __func__ << ": PASSED" << fmt::endl;
+	}
+	else
+	{
+		Info() << "ta: " << __func__ << ": FAILED" << fmt::endl;
+	}
+
+	return ret;
+}
+
+// Lock contention benchmark data
+static const size_t _lockIterations = 10000;
+
+struct Lock_Bench
+{
+	sync::Spinlock ticket;
+	sync::McsLock mcs;
+	bool useMcs;
+	volatile uint64_t counter;
+	volatile uint32_t start;
+	volatile uint32_t done;
+};
+
+static Lock_Bench lockBench;
+
+static void Lock_Bench_Worker(void* arg)
+{
+	Lock_Bench& b = *static_cast<Lock_Bench*>(arg);
+
+	// Wait until all the cores are ready, so they really contend for the lock
+	Wait_Value(&b.start, 1U);
+
+	for (size_t i = 0; i < _lockIterations; i++)
+	{
+		if (b.useMcs)
+		{
+			sync::McsNode node;
+			uint64_t flags = b.mcs.Lock(node);
+			b.counter = b.counter + 1;
+			b.mcs.Unlock(node, flags);
+		}
+		else
+		{
+			uint64_t flags = b.ticket.Lock();
+			b.counter = b.counter + 1;
+			b.ticket.Unlock(flags);
+		}
+	}
+
+	Atomic_Fetch_Add(&b.done, 1U);
+}
+
+static uint64_t Lock_Bench_Run(bool useMcs, uint32_t& nrCores)
+{
+	lockBench.useMcs = useMcs;
+	lockBench.counter = 0;
+	lockBench.start = 0;
+	lockBench.done = 0;
+
+	nrCores = 1;
+
+	// Idle secondary cores join the benchmark, current one participates as well
+	for (size_t cpu = 0; cpu < _max_cpus; cpu++)
+	{
+		if ((cpu != iCPU().Id()) && SMP_Call(cpu, Lock_Bench_Worker, &lockBench))
+		{
+			nrCores++;
+		}
+	}
+
+	uint64_t startTime = Read_Counter();
+
+	Store_Release(&lockBench.start, 1U);
+	Lock_Bench_Worker(&lockBench);
+
+	while (Load_Acquire(&lockBench.done) != nrCores)
+	{
+		Cpu_Relax();
+	}
+
+	return Read_Counter() - startTime;
+}
+
+static bool LOCK_Contention_Test(void)
+{
+	uint64_t freq = ReadArm64Reg(CNTFRQ_EL0);
+	bool ret = true;
+
+	for (size_t i = 0; i < 2; i++)
+	{
+		bool useMcs = (i > 0);
+		uint32_t nrCores;
+		uint64_t ticks = Lock_Bench_Run(useMcs, nrCores);
+		uint64_t ops = _lockIterations * nrCores;
+
+		Log() << "  /" << (useMcs ? "MCS" : "ticket") << " lock: " << nrCores << " core(s), "
+		      << (ticks * 1000000000 / freq) / ops << " ns per lock/unlock" << fmt::endl;
+
+		// Any lost update means broken mutual exclusion
+		if (lockBench.counter != ops)
+		{
+			Log() << "  /counter = " << lockBench.counter << ", expected = " << ops << fmt::endl;
+			ret = false;
+		}
+	}
+
+	if (ret)
+	{
+		Info() << "ta: " << __func__ << ": PASSED" << fmt::endl;
+	}
+	else
+	{
+		Info() << "ta: " << __func__ << ": FAILED" << fmt::endl;
+	}
+
+	return ret;
+}
+
+// Deferred work test data
+static const uint32_t _workINT = 8;
+static uint32_t workOrder[3];
+static size_t workCount = 0;
+static bool workInHandler = false;
+static bool workCoalesced = false;
+
+static void Work_Handler(void* arg)
+{
+	if (workCount < 3)
+	{
+		workOrder[workCount] = static_cast<uint32_t>(reinterpret_cast<uint64_t>(arg));
+	}
+
+	workCount++;
+}
+
+static Work_Item lowWork(Work_Handler, reinterpret_cast<void*>(2));
+static Work_Item normalWork(Work_Handler, reinterpret_cast<void*>(1));
+static Work_Item highWork(Work_Handler, reinterpret_cast<void*>(0));
+
+static void SGI_Work_Handler(uint32_t id)
+{
+	iWork().Queue_Work(lowWork, Work_Priority::Low);
+	iWork().Queue_Work(normalWork, Work_Priority::Normal);
+	iWork().Queue_Work(highWork, Work_Priority::High);
+
+	// The second request for queued work is merged
+	workCoalesced = (false == iWork().Queue_Work(lowWork, Work_Priority::Low));
+
+	// Work must not be executed within INT handler
+	workInHandler = (workCount > 0);
+}
+
+static bool WORK_Smoke_Test(void)
+{
+	Log() << "  /queue work of three priorities from SGI handler" << fmt::endl;
+
+	iIC().Register_IRq_Handler(_workINT, SGI_Work_Handler);
+	iIC().Send_SGI(1, _workINT);
+
+	bool ret = (3 == workCount) && workCoalesced && (false == workInHandler) &&
+		   (0 == workOrder[0]) && (1 == workOrder[1]) && (2 == workOrder[2]);
+
+	if (ret)
+	{
+		Info() << "ta: " << __func__ << ": PASSED" << fmt::endl;
+	}
+	else
+	{
+		Info() << "ta: " << __func__ << ": FAILED" << fmt::endl;
+	}
+
+	return ret;
+}
+
+// Console benchmark data
+static const size_t _consoleLines = 8;
+
+static uint64_t Console_Bench_Run(void)
+{
+	uint64_t start = Read_Counter();
+
+	for (size_t i = 0; i < _consoleLines; i++)
+	{
+		Log() << "  /console line " << i << ", dec " << start << ", hex 0x" << fmt::hex << fmt::fill << start << fmt::endl;
+	}
+
+	return (Read_Counter() - start) / _consoleLines;
+}
+
+static bool CONSOLE_Bench_Test(void)
+{
+	uint64_t freq = ReadArm64Reg(CNTFRQ_EL0);
+
+	// The same Log() line is printed at log level and filtered out at info one
+	iConsole().SetLevel(llevel::log);
+	uint64_t printed = Console_Bench_Run();
+
+	iConsole().SetLevel(llevel::info);
+	uint64_t filtered = Console_Bench_Run();
+
+	Info() << "  /Log() line: " << (printed * 1000000000 / freq) << " ns printed, "
+	       << (filtered * 1000000000 / freq) << " ns filtered" << fmt::endl;
+
+	bool ret = (filtered < printed);
+
+	if (ret)
+	{
+		Info() << "ta: " << __func__ << ": PASSED" << fmt::endl;
+	}
+	else
+	{
+		Info() << "ta: " << __func__ << ": FAILED" << fmt::endl;
+	}
+
+	return ret;
+}
+
+// Timer jitter test data
+static const uint64_t _jitterPeriod = 1000;		// Microseconds
+static const uint32_t _jitterSamples = 100;
+static const uint64_t _jitterLoad = 50;			// Masked section in microseconds
+
+struct Timer_Jitter
+{
+	Timer_Event event;
+	lib::Histogram lateness;
+	volatile uint32_t samples;
+};
+
+static Timer_Jitter timerJitter;
+
+static void Timer_Jitter_Handler(void* arg)
+{
+	Timer_Jitter& j = *static_cast<Timer_Jitter*>(arg);
+
+	// Deadline of the fired event is kept until the handler returns
+	j.lateness.Add(Read_Counter() - j.event.deadline);
+
+	if (++j.samples == _jitterSamples)
+	{
+		iTimer().Stop(j.event);
+	}
+}
+
+static bool TIMER_Jitter_Test(void)
+{
+	uint64_t freq = ReadArm64Reg(CNTFRQ_EL0);
+	uint64_t period = iTimer().Ticks(_jitterPeriod);
+	uint64_t load = iTimer().Ticks(_jitterLoad);
+
+	timerJitter.event = Timer_Event(Timer_Jitter_Handler, &timerJitter);
+	timerJitter.lateness.Reset();
+	timerJitter.samples = 0;
+
+	Log() << "  /periodic " << _jitterPeriod << "us timer, " << _jitterSamples << " samples" << fmt::endl;
+
+	iTimer().Start(timerJitter.event, Read_Counter() + period, period);
+
+	// Guest exits are handled with INTs masked, so emulate them by short masked sections
+	uint64_t timeout = Read_Counter() + period * _jitterSamples * 2;
+
+	while ((timerJitter.samples < _jitterSamples) && (Read_Counter() < timeout))
+	{
+		uint64_t flags = sync::Local_IRq_Save();
+		uint64_t end = Read_Counter() + load;
+
+		while (Read_Counter() < end);
+
+		sync::Local_IRq_Restore(flags);
+	}
+
+	iTimer().Stop(timerJitter.event);
+
+	const lib::Histogram& h = timerJitter.lateness;
+
+	Log() << "    <- lateness min = " << (h.Min() * 1000000000 / freq) << " ns, avg = " << (h.Avg() * 1000000000 / freq)
+	      << " ns, p99 <= " << (h.Percentile(99) * 1000000000 / freq) << " ns, max = " << (h.Max() * 1000000000 / freq)
+	      << " ns" << fmt::endl;
+
+	// Callback could be delayed by masked section only, so it never misses the period
+	bool ret = (_jitterSamples == timerJitter.samples) &&
+		   (false == iTimer().Pending(timerJitter.event)) &&
+		   (h.Max() < period);
+
+	if (ret)
+	{
+		Info() << "ta: " << __func__ << ": PASSED" << fmt::endl;
+	}
+	else
+	{
+		Info() << "ta: " << __func__ << ": FAILED" << fmt::endl;
+	}
+
+	return ret;
+}
+
 void TA_Start(void)
 {
 	Log() << "app: testing adapter" << fmt::endl;
 
 	INT_Smoke_Test();
+	INT_Batch_Test();
+	INT_Preemption_Test();
+	INT_Timing_Test();
 	CPU_Smoke_Test();
 	HEAP_Smoke_Test();
 	RINGBUFFER_Smoke_Test();
+	RINGBUFFER_Bulk_Test();
 	MMU_Smoke_Test();
 	LIST_Smoke_Test();
+	ILIST_Smoke_Test();
+	CONTAINERS_Smoke_Test();
+	LOCK_Contention_Test();
+	TIMER_Jitter_Test();
+	WORK_Smoke_Test();
+	CONSOLE_Bench_Test();
 }
 
 }; // namespace apps
@@ -11,13 +11,16 @@
 // specific language governing permissions and limitations under the License.
 
 #include "uart_pl011.hpp"
+#include "virt_uart_pl011.hpp"
 
 #include <bsp/platform>
 #include <core/iconsole>
 #include <core/iic>
 #include <core/ivirtic>
 #include <core/ivmm>
+#include <core/iwork>
 #include <mmap>
+#include <mops>
 #include <system>
 
 namespace saturn {
@@ -31,9 +34,18 @@ static const uint32_t _pl011_int = 33;	// PL011 UART interrupt in QEMU virt mach
 UartPl011* UartPl011::Self = nullptr;
 
 UartPl011::UartPl011()
+	: guestVM(0)
+	, guestUart(nullptr)
+	, rxWork(RxWork, this)
+	, txLock()
+	, txIRq(false)
+	, txSync(false)
 {
 	UartPl011::Self = this;
 
+	rxData = new SPSC_RingBuffer<char, _rxDataSize>();
+	txData = new RingBuffer<uint8_t, _txDataSize>(rb::full_overwrite);
+
 	// TBD: destroy the allocated data
 	Regs = new MMap(MMap::IO_Region(_uart_addr));
 
@@ -57,6 +69,11 @@ UartPl011::UartPl011()
 	lcr_h |= (1 << 4);
 	Regs->Write<uint32_t>(Pl011_Regs::LCR_H, lcr_h);
 
+	// TX INT is requested when FIFO is almost empty, so there are less INTs per byte
+	uint32_t ifls = Regs->Read<uint32_t>(Pl011_Regs::IFLS);
+	ifls = (ifls & ~Reg_IFLS::TXLevelMask) | Reg_IFLS::TXLevel_1_4;
+	Regs->Write<uint32_t>(Pl011_Regs::IFLS, ifls);
+
 	// Enable RX interrupts
 	Regs->Write<uint32_t>(Pl011_Regs::IMSC, Pl011_INT::RX);
 
@@ -71,14 +88,89 @@ UartPl011::UartPl011()
 void UartPl011::Rx(uint8_t *buff, size_t len)
 {}
 
+void UartPl011::Tx_Kick(void)
+{
+	uint8_t c;
+
+	while (!(Regs->Read<uint32_t>(Pl011_Regs::FR) & Reg_FR::TXFull) && txData->Out(c))
+	{
+		Regs->Write<uint8_t>(Pl011_Regs::TDR, c);
+	}
+
+	// TX INT is triggered when FIFO level passes the threshold, so it's enabled
+	// only while there is data to send
+	bool irq = !txData->Empty();
+
+	if (irq != txIRq)
+	{
+		uint32_t imsc = Regs->Read<uint32_t>(Pl011_Regs::IMSC);
+		imsc = irq ? (imsc | Pl011_INT::TX) : (imsc & ~Pl011_INT::TX);
+		Regs->Write<uint32_t>(Pl011_Regs::IMSC, imsc);
+
+		txIRq = irq;
+	}
+}
+
+void UartPl011::Tx_Direct(uint8_t *buff, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+	{
+		while (Regs->Read<uint32_t>(Pl011_Regs::FR) & Reg_FR::TXFull);
+
+		Regs->Write<uint8_t>(Pl011_Regs::TDR, buff[i]);
+	}
+}
+
 void UartPl011::Tx(uint8_t *buff, size_t len)
 {
-	while (len--)
+	if (txSync)
+	{
+		// Fault could happen on this core while the lock is taken, so the output
+		// bypasses the ring and goes to FIFO directly
+		uint64_t flags;
+		bool locked = txLock.Try_Lock(flags);
+
+		Tx_Direct(buff, len);
+
+		if (locked)
+		{
+			txLock.Unlock(flags);
+		}
+
+		return;
+	}
+
+	uint64_t flags = txLock.Lock();
+
+	// Caller never waits for serial line: if output is produced faster than it's
+	// sent, the oldest data is overwritten
+	txData->In(buff, len);
+
+	// Fill FIFO right now, the rest is sent from TX INT
+	Tx_Kick();
+
+	txLock.Unlock(flags);
+}
+
+void UartPl011::Flush(void)
+{
+	uint64_t flags;
+
+	// Switch to synchronous output first, so Tx() never waits for the lock from now
+	txSync = true;
+
+	// Fault could happen while the lock is taken, then the ring could be in the
+	// middle of update and the buffered data is dropped
+	if (txLock.Try_Lock(flags))
 	{
-		// Wait for UART to be ready
-		while (Regs->Read<uint32_t>(Pl011_Regs::FR) & Reg_FR::Busy);
+		uint8_t c;
 
-		Regs->Write<uint8_t>(Pl011_Regs::TDR, *buff++);
+		while (txData->Out(c))
+		{
+			Tx_Direct(&c, 1);
+		}
+
+		txLock.Unlock(flags);
 	}
 }
 
@@ -94,17 +186,25 @@ void UartPl011::HandleIRq(void)
 		status &= ~Pl011_INT::RX;
 		uint16_t fr = Regs->Read<uint16_t>(Pl011_Regs::FR);
 
+		// RX INT is level-sensitive, so FIFO is drained here and the data is
+		// processed later by deferred work
 		while (!(fr & Reg_FR::RXEmpty)) {
 			uint8_t data = Regs->Read<uint16_t>(Pl011_Regs::TDR) & 0xff;
-			iConsole().RxChar(static_cast<char>(data));
+			rxData->In(static_cast<char>(data));
 
 			fr = Regs->Read<uint16_t>(Pl011_Regs::FR);
 		}
 
-		if (iVMM().Get_VM_State() == vm_state::running)
-		{
-			iVirtIC().Inject_VM_IRq(_pl011_int, vINTtype::Software);
-		}
+		iWork().Queue_Work(rxWork, Work_Priority::Normal);
+	}
+
+	if (status & Pl011_INT::TX)
+	{
+		status &= ~Pl011_INT::TX;
+
+		uint64_t flags = txLock.Lock();
+		Tx_Kick();
+		txLock.Unlock(flags);
 	}
 
 	if (status != 0)
@@ -114,6 +214,40 @@ void UartPl011::HandleIRq(void)
 	}
 }
 
+void UartPl011::RxWork(void* arg)
+{
+	UartPl011* uart = static_cast<UartPl011*>(arg);
+	char c;
+
+	while (uart->rxData->Out(c))
+	{
+		iConsole().RxChar(c);
+	}
+
+	if (nullptr != uart->guestUart)
+	{
+		uart->guestUart->Update_Status();
+	}
+
+	// Work is executed on the core which took UART INT, so it's the core of the guest
+	if (iVMM().Get_VM_State() == vm_state::running)
+	{
+		iVirtIC().Inject_VM_IRq(uart->guestVM, _pl011_int, vINTtype::Software);
+	}
+}
+
+void UartPl011::Set_Affinity(size_t cpu)
+{
+	iIC().Set_IRq_Affinity(_pl011_int, cpu);
+}
+
+void UartPl011::Attach_VM(size_t vm, size_t cpu, VirtUartPl011& vuart)
+{
+	guestVM = vm;
+	guestUart = &vuart;
+	Set_Affinity(cpu);
+}
+
 // Static method to register within IC. It forwards the handling to Pl011 object via static pointer.
 void UartPl011::UartIRqHandler(uint32_t id)
 {
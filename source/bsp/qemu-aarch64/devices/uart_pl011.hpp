@@ -12,7 +12,10 @@
 
 #pragma once
 
+#include <core/iwork>
 #include <dev/uart>
+#include <ringbuffer>
+#include <sync/spinlock>
 
 namespace saturn {
 
@@ -21,6 +24,16 @@ class MMap;
 
 namespace device {
 
+// Forward declaration
+class VirtUartPl011;
+
+// RX data moved from FIFO by INT handler, but not yet processed by deferred work. There is
+// single producer and single consumer, so the ring is lock-free.
+static const size_t _rxDataSize = 64;
+
+// TX data which waits for free space in FIFO
+static const size_t _txDataSize = 4096;
+
 struct Pl011Regs
 {
 	uint32_t cr;
@@ -37,6 +50,7 @@ enum Pl011_Regs {
 	FBRD		= 0x28,		// Fractional baud rate register
 	LCR_H		= 0x2c,		// Line control register
 	CR		= 0x30,		// Control register
+	IFLS		= 0x34,		// Interrupt FIFO level select register
 	RIS		= 0x3c,		// Raw interrupt status register
 	IMSC		= 0x38,		// Interrupt mask register
 	ICR		= 0x44,		// Interrupt clear register
@@ -50,11 +64,18 @@ enum Reg_CR {
 
 enum Reg_FR {
 	Busy	= 1 << 3,	// UART busy bit
-	RXEmpty = 1 << 4	// RX FIFO empty bit
+	RXEmpty = 1 << 4,	// RX FIFO empty bit
+	TXFull	= 1 << 5	// TX FIFO full bit
+};
+
+enum Reg_IFLS {
+	TXLevelMask	= 0x7,		// TX INT FIFO level select
+	TXLevel_1_4	= 0x1		// TX INT when FIFO becomes <= 1/4 full
 };
 
 enum Pl011_INT {
-	RX	= 1 << 4	// RX interrupt
+	RX	= 1 << 4,	// RX interrupt
+	TX	= 1 << 5	// TX interrupt
 };
 
 class UartPl011 : public IUartDevice
@@ -66,7 +87,12 @@ public:
 public:
 	void Rx(uint8_t *buff, size_t len);
 	void Tx(uint8_t *buff, size_t len);
+	void Flush(void);
 	void HandleIRq(void);
+	// Route UART INT to the CPU core
+	void Set_Affinity(size_t cpu);
+	// Forward console input to the partition which runs on the CPU core
+	void Attach_VM(size_t vm, size_t cpu, VirtUartPl011& vuart);
 
 public:
 	void Load_State(Pl011Regs& regs);
@@ -76,8 +102,29 @@ private:
 	static void UartIRqHandler(uint32_t);
 	static UartPl011* Self;
 
+	// Console input and guest notification are deferred from INT handler
+	static void RxWork(void* arg);
+
+	// Must be called with TX lock taken
+	void Tx_Kick(void);
+	// Write to FIFO bypassing the ring, used in synchronous mode
+	void Tx_Direct(uint8_t *buff, size_t len);
+
 private:
 	MMap* Regs;
+	size_t guestVM;
+	VirtUartPl011* guestUart;
+
+	SPSC_RingBuffer<char, _rxDataSize>* rxData;
+	core::Work_Item rxWork;
+
+	// TX ring is drained by TX INT, so logging doesn't wait for serial line. The lock
+	// keeps the order of bytes which are moved from the ring to FIFO by several cores.
+	sync::Spinlock txLock;
+	RingBuffer<uint8_t, _txDataSize>* txData;
+	bool txIRq;
+	// Output is written synchronously after fault
+	bool txSync;
 };
 
 }; // namespace device
@@ -15,20 +15,27 @@
 
 #include <bsp/platform>
 #include <core/iconsole>
+#include <system>
 
 namespace saturn {
 namespace device {
 
 using namespace core;
 
-static struct Pl011Regs _pl011_state;
+static struct Pl011Regs _pl011_state[_max_vms];
 
-VirtUartPl011::VirtUartPl011(UartPl011& uart)
+VirtUartPl011::VirtUartPl011(UartPl011& uart, size_t vm)
 	: hwUart(uart)
-	, regState(_pl011_state)
+	, regState(_pl011_state[vm])
+	, consoleRx(0 == vm)
+	, flags(0)
 {
 	mTrap = new MTrap(_uart_addr, *this);
 
+	// Guest polls the flags for each character, so serve them without full exit
+	Update_Status();
+	mTrap->Fast_Read(Pl011_Regs::FR, &flags);
+
 	hwUart.Load_State(regState);
 }
 
@@ -43,23 +50,21 @@ void VirtUartPl011::Read(uint64_t reg, void* data, AccessSize size)
 	case Pl011_Regs::TDR:
 		{
 			// Get char from console buffer
-			char c = iConsole().GetChar(iomode::async);
+			char c = consoleRx ? iConsole().GetChar(iomode::async) : 0;
 			uint32_t* tdr = static_cast<uint32_t*>(data);
 
 			*tdr = c;
 
+			Update_Status();
+
 			break;
 		}
 	case Pl011_Regs::FR:
 		{
-			// Notify that UART is always ready
 			uint16_t* fr = static_cast<uint16_t*>(data);
-			*fr = (1 << 7);
 
-			if (iConsole().RxFifoEmpty())
-			{
-				*fr |= 0x10;
-			}
+			Update_Status();
+			*fr = flags;
 			break;
 		}
 	case Pl011_Regs::IMSC:
@@ -77,7 +82,7 @@ void VirtUartPl011::Read(uint64_t reg, void* data, AccessSize size)
 	case Pl011_Regs::RIS:
 		{
 			uint32_t* val = static_cast<uint32_t*>(data);
-			if (iConsole().RxFifoEmpty())
+			if (!consoleRx || iConsole().RxFifoEmpty())
 			{
 				*val = 0;
 			}
@@ -115,6 +120,19 @@ void VirtUartPl011::Read(uint64_t reg, void* data, AccessSize size)
 	}
 }
 
+void VirtUartPl011::Update_Status(void)
+{
+	// Notify that UART is always ready
+	uint32_t fr = (1 << 7);
+
+	if (!consoleRx || iConsole().RxFifoEmpty())
+	{
+		fr |= Reg_FR::RXEmpty;
+	}
+
+	flags = fr;
+}
+
 void VirtUartPl011::Write(uint64_t reg, void* data, AccessSize size)
 {
 	switch (reg)
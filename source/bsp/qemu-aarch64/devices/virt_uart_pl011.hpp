@@ -23,17 +23,22 @@ class UartPl011;
 class VirtUartPl011 : public IVirtIO
 {
 public:
-	VirtUartPl011(UartPl011&);
+	VirtUartPl011(UartPl011&, size_t vm);
 	~VirtUartPl011();
 
 public:
 	void Read(uint64_t addr, void* data, AccessSize size);
 	void Write(uint64_t addr, void* data, AccessSize size);
+	// Refresh flag register, it's read by guest in exception fast path
+	void Update_Status(void);
 
 private:
 	MTrap* mTrap;
 	UartPl011& hwUart;
 	struct Pl011Regs& regState;
+	// Only the console partition receives input
+	bool consoleRx;
+	volatile uint32_t flags;
 };
 
 }; // namespace device
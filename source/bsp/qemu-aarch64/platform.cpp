@@ -13,6 +13,8 @@
 #include "platform.hpp"
 
 #include <core/iconsole>
+#include <core/icpu>
+#include <core/iic>
 #include <core/ivmm>
 #include <mops>
 
@@ -37,41 +39,65 @@ void BSP_Init(void)
 }
 
 QemuArm64Platform::QemuArm64Platform()
-	: Uart(nullptr)
-	, VirtUart(nullptr)
+	: osStorage()
+	, Uart(nullptr)
+	, VirtUart()
 {
 	Uart = new device::UartPl011();
 	iConsole().RegisterUart(*Uart);
 
-	osStorage = new OS_Storage;
+	// Load generated INT storm protection settings
+	generated::IRq_Storm_Configuration(iIC());
 }
 
-void QemuArm64Platform::Load_VM_Configuration(core::IVirtualMachineConfig& vmConfig)
+size_t QemuArm64Platform::Get_Nr_VMs(void)
 {
-	// Load generated configuration
-	generated::VM_Configuration(vmConfig);
-	generated::OS_Storage_Configuration(*osStorage);
+	return generated::Nr_Partitions;
 }
 
-void QemuArm64Platform::Prepare_OS(struct AArch64_Regs& guestContext)
+void QemuArm64Platform::Load_VM_Configuration(size_t vm, core::IVirtualMachineConfig& vmConfig)
 {
-	if (osStorage->Get_OS_Type() == OS_Type::Linux)
+	if ((vm < generated::Nr_Partitions) && (vm < _max_vms))
+	{
+		osStorage[vm] = new OS_Storage(vm);
+
+		// Load generated configuration
+		generated::VM_Configurations[vm](vmConfig);
+		generated::OS_Storage_Configurations[vm](*osStorage[vm]);
+	}
+}
+
+void QemuArm64Platform::Load_VM_Schedule(core::IVirtualMachineSchedule& schedule)
+{
+	generated::Schedule_Configuration(schedule);
+}
+
+void QemuArm64Platform::Prepare_OS(size_t vm, struct AArch64_Regs& guestContext)
+{
+	if (osStorage[vm]->Get_OS_Type() == OS_Type::Linux)
 	{
 		guestContext.x0 = 0x43000000;		// Device tree address
 	}
 
-	osStorage->Load_Images();
+	osStorage[vm]->Load_Images();
 }
 
-void QemuArm64Platform::Start_Virtual_Devices(void)
+void QemuArm64Platform::Start_Virtual_Devices(size_t vm)
 {
-	if (nullptr == VirtUart)
+	// Trap region is registered for the partition loaded on the core
+	if (nullptr == VirtUart[vm])
+	{
+		VirtUart[vm] = new device::VirtUartPl011(*Uart, vm);
+	}
+
+	// Console input goes to the core which runs the first partition
+	if (0 == vm)
 	{
-		VirtUart = new device::VirtUartPl011(*Uart);
+		Uart->Attach_VM(vm, iCPU().Id(), *VirtUart[vm]);
 	}
 }
 
-void QemuArm64Platform::Stop_Virtual_Devices(void)
+void QemuArm64Platform::Stop_Virtual_Devices(size_t vm)
 {
 	// TBD: shutdown Uart
 }
@@ -18,6 +18,7 @@
 
 #include <bsp/ibsp>
 #include <bsp/os_storage>
+#include <system>
 
 namespace saturn {
 namespace bsp {
@@ -28,17 +29,20 @@ public:
 	QemuArm64Platform();
 
 public:
-	void Load_VM_Configuration(core::IVirtualMachineConfig&);
-	void Start_Virtual_Devices(void);
-	void Stop_Virtual_Devices(void);
-	void Prepare_OS(struct AArch64_Regs&);
+	size_t Get_Nr_VMs(void);
+	void Load_VM_Configuration(size_t, core::IVirtualMachineConfig&);
+	void Load_VM_Schedule(core::IVirtualMachineSchedule&);
+	void Start_Virtual_Devices(size_t);
+	void Stop_Virtual_Devices(size_t);
+	void Prepare_OS(size_t, struct AArch64_Regs&);
 
 private:
-	OS_Storage* osStorage;
+	OS_Storage* osStorage[_max_vms];
 
 private:
 	device::UartPl011* Uart;
-	device::VirtUartPl011* VirtUart;
+	// Each partition has own virtual UART, console input goes to the first one
+	device::VirtUartPl011* VirtUart[_max_vms];
 };
 
 // Access to console
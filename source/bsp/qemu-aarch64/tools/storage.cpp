@@ -12,33 +12,29 @@
 
 #include "storage.hpp"
 
+#include <arm64/registers>
 #include <core/iconsole>
 #include <core/immu>
 #include <mops>
+#include <system>
 
 namespace saturn {
 namespace bsp {
 
-// TBD: size of OS storage
-static const size_t _nrImages = 3;
-// Local table to keep information about guest OS images
-static OS_Storage_Entry _osImages[_nrImages];
+// Local tables to keep information about guest OS images per partition
+static OS_Image_Table _osImages[_max_vms];
 
-OS_Storage::OS_Storage()
-	: osImages(_osImages)
-	, nrImages(0)
-{}
+OS_Storage::OS_Storage(size_t id)
+	: osImages(_osImages[id])
+{
+	osImages.clear();
+}
 
 void OS_Storage::Add_Image(uint64_t source, uint64_t target, size_t size)
 {
-	if (nrImages < _nrImages)
-	{
-		osImages[nrImages].sourcePA = source;
-		osImages[nrImages].targetPA = target;
-		osImages[nrImages].size = size;
+	OS_Storage_Entry entry = {source, target, size};
 
-		nrImages++;
-	}
+	osImages.push_back(entry);
 }
 
 void OS_Storage::Load_Images()
@@ -46,9 +42,8 @@ void OS_Storage::Load_Images()
 	using namespace core;
 
 	// Load OS images
-	for (size_t i = 0; i < nrImages; i++)
+	for (auto& entry : osImages)
 	{
-		OS_Storage_Entry& entry = osImages[i];
 		Memory_Region sourceRegion = {entry.sourcePA, entry.sourcePA, entry.size, MMapType::Normal};
 		Memory_Region targetRegion = {entry.targetPA, entry.targetPA, entry.size, MMapType::Normal};
 
@@ -57,9 +52,13 @@ void OS_Storage::Load_Images()
 
 		Info() << "vmm: copy OS binary from storage to 0x" << fmt::fill << fmt::hex << entry.targetPA << ": ";
 
+		uint64_t start = Read_Counter();
+
 		MCopy<uint8_t>((void *)entry.sourcePA, (void *)entry.targetPA, entry.size);
 
-		Raw() << "OK" << fmt::endl;
+		uint64_t us = ((Read_Counter() - start) * 1000000) / ReadArm64Reg(CNTFRQ_EL0);
+
+		Raw() << "OK, " << fmt::nofill << fmt::dec << entry.size << " bytes in " << us << " us" << fmt::endl;
 
 		iMMU().MemoryUnmap(targetRegion);
 		iMMU().MemoryUnmap(sourceRegion);
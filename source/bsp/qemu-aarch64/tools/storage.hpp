@@ -13,14 +13,20 @@
 #pragma once
 
 #include <bsp/os_storage>
+#include <lib/vector>
 
 namespace saturn {
 namespace bsp {
 
+// TBD: size of OS storage
+static const size_t _nrImages = 3;
+
+using OS_Image_Table = lib::StaticVector<OS_Storage_Entry, _nrImages>;
+
 class OS_Storage
 {
 public:
-	OS_Storage();
+	OS_Storage(size_t id);
 	~OS_Storage();
 
 public:
@@ -31,8 +37,7 @@ public:
 
 private:
 	// OS storage configuration
-	size_t nrImages;
-	OS_Storage_Entry (&osImages)[];
+	OS_Image_Table& osImages;
 	OS_Type osType;
 };
 
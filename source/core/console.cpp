@@ -12,6 +12,7 @@
 
 #include "console.hpp"
 
+#include <arm64/registers>
 #include <core/ivmm>
 
 namespace saturn {
@@ -19,22 +20,44 @@ namespace core {
 
 using namespace device;
 
-static const size_t _max_message_size = 128;
-
 // Local CPU console buffer to cache the data if UART driver is not active.
 // This is very important for early console messages.
 static char _txBuffer[_tx_size];
 
+// Console is used before per-CPU areas are initialized, so lines are indexed by MPIDR
+static Console_Line _lines[_max_cpus][_line_levels];
+
+// Two decimal digits are converted per division
+static const char _decPairs[] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+static const char _hexDigits[] = "0123456789abcdef";
+
 Console::Console()
 	: isActive(false)
-	, isHex(false)
-	, isFill(false)
-	, isLevel(false)
 	, uart(nullptr)
-	, currentMsgLevel(llevel::info)
 	, consoleLevel(llevel::info)
+	, lines(_lines)
 	, cmdMode(false)
 {
+	for (size_t i = 0; i < _max_cpus; i++)
+	{
+		for (size_t j = 0; j < _line_levels; j++)
+		{
+			lines[i][j].len = 0;
+			lines[i][j].level = llevel::info;
+			lines[i][j].isHex = false;
+			lines[i][j].isFill = false;
+			lines[i][j].isLevel = false;
+		}
+
+		lineLevel[i] = 0;
+	}
+
 	txBuffer = new RingBuffer<char, _tx_size>(rb::full_overwrite, _txBuffer);
 	rxBuffer = new RingBuffer<char, _rx_size>(rb::full_ignore);
 
@@ -43,13 +66,14 @@ Console::Console()
 
 void Console::RegisterUart(IUartDevice& u)
 {
-	char c;
+	char chunk[_line_size];
+	size_t n;
 
 	uart = &u;
 
-	while (txBuffer->Out(c))
+	while ((n = txBuffer->Out(chunk, _line_size)) > 0)
 	{
-		uart->Tx(reinterpret_cast<uint8_t *>(&c), 1);
+		uart->Tx(reinterpret_cast<uint8_t *>(chunk), n);
 	}
 
 	isActive = true;
@@ -66,10 +90,14 @@ bool Console::RxChar(char sym)
 			case systemKeys::cmdBeep:
 				Raw() << fmt::endl << "(beep)" << fmt::endl;
 				break;
+			case systemKeys::cmdPause:
+				// The same as for shutdown, VM is paused on exit from the INT
+				iVMM().Pause_VM();
+				break;
 			case systemKeys::cmdShutdown:
-				// We can't stop VM because we are inside UART interrupt handler
-				// so the first call Stop_VM() will notify Saturn, and it will stop
-				// VM in the right place (see traps handler)
+				// We can't stop VM because we are inside deferred work of UART
+				// interrupt, so the first call Stop_VM() will notify Saturn, and it
+				// will stop VM in the right place (see IRq handler)
 				iVMM().Stop_VM();
 				break;
 			default:
@@ -108,7 +136,7 @@ char Console::GetChar(iomode mode)
 	{
 		while (rxBuffer->Out(c) == false)
 		{
-			asm volatile("wfi" : : : "memory");
+			Wait_For_Interrupt();
 		}
 	}
 	else
@@ -122,15 +150,80 @@ char Console::GetChar(iomode mode)
 	return c;
 }
 
-Console& Console::operator<<(char c)
+Console_Line& Console::Line(void)
 {
+	size_t cpu = (Read_Mpidr() & 0xff) % _max_cpus;
+	size_t level = lineLevel[cpu];
+
+	return lines[cpu][(level < _line_levels) ? level : (_line_levels - 1)];
+}
+
+bool Console::Suppressed(Console_Line& line)
+{
+	return line.level < consoleLevel;
+}
+
+void Console::Put(Console_Line& line, const char* str, size_t len)
+{
+	while (len > 0)
+	{
+		size_t chunk = _line_size - line.len;
+
+		if (chunk > len)
+		{
+			chunk = len;
+		}
+
+		// Plain memory, so let compiler optimize the copy
+		for (size_t i = 0; i < chunk; i++)
+		{
+			line.buf[line.len + i] = str[i];
+		}
+
+		line.len += chunk;
+		str += chunk;
+		len -= chunk;
+
+		// Too long message is sent by parts
+		if (_line_size == line.len)
+		{
+			Commit(line);
+		}
+	}
+
+	// Raw output is interactive (prompt, echo), so it's not buffered
+	if (llevel::none == line.level)
+	{
+		Commit(line);
+	}
+}
+
+void Console::Commit(Console_Line& line)
+{
+	if (0 == line.len)
+	{
+		return;
+	}
+
 	if (isActive)
 	{
-		uart->Tx(reinterpret_cast<uint8_t *>(&c), 1);
+		uart->Tx(reinterpret_cast<uint8_t*>(line.buf), line.len);
 	}
 	else
 	{
-		txBuffer->In(c);
+		txBuffer->In(line.buf, line.len);
+	}
+
+	line.len = 0;
+}
+
+Console& Console::operator<<(char c)
+{
+	Console_Line& line = Line();
+
+	if (false == Suppressed(line))
+	{
+		Put(line, &c, 1);
 	}
 
 	return *this;
@@ -138,103 +231,118 @@ Console& Console::operator<<(char c)
 
 Console& Console::operator<<(char const *msg)
 {
-	char buf[_max_message_size];
-	size_t len = 0;
+	Console_Line& line = Line();
+
+	if (Suppressed(line))
+	{
+		return *this;
+	}
+
+	// We need this to handle line breaks in the middle of message, for example:
+	//   Log() << "Line break" << fmt::endl << "in the middle of message" << fmt::endl;
+	ShowLogLevel(line);
+
+	// Plain text is copied by chunks between escape sequences
+	const char* chunk = msg;
 	char c;
 
-	if (currentMsgLevel >= consoleLevel)
+	while ((c = *msg) != 0)
 	{
-		// We need this to handle line breaks in the middle of message, for example:
-		//   Log() << "Line break" << fmt::endl << "in the middle of message" << fmt::endl;
-		ShowLogLevel();
+		if (c != '\\')
+		{
+			msg++;
+			continue;
+		}
+
+		Put(line, chunk, msg - chunk);
+		msg++;
 
-		while ((c = *msg++) != 0)
+		switch (*msg)
 		{
-			if (c == '\\')
-			{
-				c = *msg++;
-				switch(c)
-				{
-				case 'n':
-					c = 0x0a;
-					break;
-				case 'r':
-					c = 0x0d;
-					break;
-				case 'b':
-					c = 0x08;
-					break;
-				case '\\':
-					break;
-				default:
-					buf[len++] = '\\';
-					break;
-				}
-			}
-
-			buf[len++] = c;
+		case 'n':
+			c = 0x0a;
+			break;
+		case 'r':
+			c = 0x0d;
+			break;
+		case 'b':
+			c = 0x08;
+			break;
+		case '\\':
+			break;
+		default:
+			// Not an escape sequence, so the next symbol is kept as is
+			c = 0;
+			break;
 		}
 
-		if (isActive)
+		if (c != 0)
 		{
-			uart->Tx(reinterpret_cast<uint8_t*>(buf), len);
+			msg++;
 		}
 		else
 		{
-			size_t i = 0;
-			while (i < len)
-			{
-				txBuffer->In(buf[i]);
-				i++;
-			}
+			c = '\\';
 		}
+
+		Put(line, &c, 1);
+		chunk = msg;
 	}
 
+	Put(line, chunk, msg - chunk);
+
 	return *this;
 }
 
 Console& Console::operator<<(int32_t num)
 {
-	uint8_t fillSize = isFill ? 8 : 0;
+	uint8_t fillSize = Line().isFill ? 8 : 0;
 	return SignedToStr(num, fillSize);
 }
 
 Console& Console::operator<<(uint32_t num)
 {
-	uint8_t fillSize = isFill ? 8 : 0;
+	uint8_t fillSize = Line().isFill ? 8 : 0;
 	return UnsignedToStr(num, fillSize);
 }
 
 Console& Console::operator<<(int64_t num)
 {
-	uint8_t fillSize = isFill ? 16 : 0;
+	uint8_t fillSize = Line().isFill ? 16 : 0;
 	return SignedToStr(num, fillSize);
 }
 
 Console& Console::operator<<(uint64_t num)
 {
-	uint8_t fillSize = isFill ? 16 : 0;
+	uint8_t fillSize = Line().isFill ? 16 : 0;
 	return UnsignedToStr(num, fillSize);
 }
 
 Console& Console::operator<<(size_t num)
 {
-	uint8_t fillSize = isFill ? 16 : 0;
+	uint8_t fillSize = Line().isFill ? 16 : 0;
 	return UnsignedToStr(num, fillSize);
 }
 
 Console& Console::SignedToStr(int64_t num, uint8_t fillSize)
 {
+	Console_Line& line = Line();
+
+	if (Suppressed(line))
+	{
+		return *this;
+	}
+
 	if (num < 0)
 	{
-		if (isHex)
+		if (line.isHex)
 		{
 			*this << "<invalid>";	// No need to support negative hex
 		}
 		else
 		{
-			*this << "-";
-			UnsignedToStr(static_cast<uint64_t>(-num), fillSize);
+			*this << '-';
+			UnsignedToStr(0 - static_cast<uint64_t>(num), fillSize);
 		}
 	}
 	else
@@ -247,59 +355,83 @@ Console& Console::SignedToStr(int64_t num, uint8_t fillSize)
 
 Console& Console::UnsignedToStr(uint64_t num, uint8_t fillSize)
 {
+	Console_Line& line = Line();
+
+	if (Suppressed(line))
+	{
+		return *this;
+	}
 
 	// Max unsigned 64 bit
-	//  - in dec: 1 777 777 777 777 777 777 777
+	//  - in dec: 18 446 744 073 709 551 615
 	//  - in hex: ffff ffff ffff ffff
-	// So the maximal literal length is 22
-	char numStr[22];
-
-	// Symbol table
-	char hexTable[] = "0123456789abcdef";
-
-	// Formating flags
-	uint8_t divBase = isHex ? 16 : 10;
-
-	char *s = numStr + sizeof(numStr);
-	*--s = 0;
+	// So the maximal literal length is 20
+	char numStr[20];
+	char* end = numStr + sizeof(numStr);
+	char* s = end;
 
-	size_t i = 0;
-	do
+	if (line.isHex)
 	{
-		*--s = hexTable[num % divBase];
-		num /= divBase;
-		i++;
+		// No division for hex, just take nibbles
+		do
+		{
+			*--s = _hexDigits[num & 0xf];
+			num >>= 4;
+		}
+		while (num > 0);
+
+		while ((end - s) < fillSize)
+		{
+			*--s = '0';
+		}
 	}
-	while (num > 0);
+	else
+	{
+		while (num >= 100)
+		{
+			uint64_t q = num / 100;
+			size_t pos = (num - q * 100) * 2;
 
+			s -= 2;
+			s[0] = _decPairs[pos];
+			s[1] = _decPairs[pos + 1];
+			num = q;
+		}
 
-	if (isHex)
-	{
-		while (i++ < fillSize)
+		if (num >= 10)
 		{
-			*--s = '0';
+			s -= 2;
+			s[0] = _decPairs[num * 2];
+			s[1] = _decPairs[num * 2 + 1];
+		}
+		else
+		{
+			*--s = static_cast<char>('0' + num);
 		}
 	}
 
-	return *this << s;
+	ShowLogLevel(line);
+	Put(line, s, end - s);
+
+	return *this;
 }
 
-void Console::ShowLogLevel()
+void Console::ShowLogLevel(Console_Line& line)
 {
-	if (false == isLevel)
+	if (false == line.isLevel)
 	{
-		isLevel = true;
+		line.isLevel = true;
 
-		switch (currentMsgLevel)
+		switch (line.level)
 		{
 		case llevel::log:
-			*this << "[log] ";
+			Put(line, "[log] ", 6);
 			break;
 		case llevel::info:
-			*this << "[inf] ";
+			Put(line, "[inf] ", 6);
 			break;
 		case llevel::error:
-			*this << "[err] ";
+			Put(line, "[err] ", 6);
 			break;
 		default:
 			break;
@@ -312,27 +444,58 @@ void Console::SetLevel(llevel level)
 	consoleLevel = level;
 }
 
+void Console::Flush(void)
+{
+	// UART is switched to synchronous mode first, so the line below doesn't wait
+	// for TX lock which could be held by interrupted code
+	if (isActive)
+	{
+		uart->Flush();
+	}
+
+	Commit(Line());
+}
+
+void Console::EnterIRq(void)
+{
+	lineLevel[(Read_Mpidr() & 0xff) % _max_cpus]++;
+}
+
+void Console::LeaveIRq(void)
+{
+	lineLevel[(Read_Mpidr() & 0xff) % _max_cpus]--;
+}
+
 Console& Console::operator<<(fmt format)
 {
+	Console_Line& line = Line();
+
+	if (Suppressed(line))
+	{
+		return *this;
+	}
+
 	switch (format)
 	{
 	case fmt::endl:
-		*this << "\r\n";
-		isHex = false;
-		isFill = false;
-		isLevel = false;
+		ShowLogLevel(line);
+		Put(line, "\r\n", 2);
+		Commit(line);
+		line.isHex = false;
+		line.isFill = false;
+		line.isLevel = false;
 		break;
 	case fmt::dec:
-		isHex = false;
+		line.isHex = false;
 		break;
 	case fmt::hex:
-		isHex = true;
+		line.isHex = true;
 		break;
 	case fmt::fill:
-		isFill = true;
+		line.isFill = true;
 		break;
 	case fmt::nofill:
-		isFill = false;
+		line.isFill = false;
 		break;
 	default:
 		break;
@@ -343,8 +506,14 @@ Console& Console::operator<<(fmt format)
 
 Console& Console::operator<<(llevel level)
 {
-	currentMsgLevel = level;
-	ShowLogLevel();
+	Console_Line& line = Line();
+
+	line.level = level;
+
+	if (false == Suppressed(line))
+	{
+		ShowLogLevel(line);
+	}
 
 	return *this;
 }
@@ -22,12 +22,32 @@ namespace core {
 using namespace device;
 
 static const size_t _rx_size = 16;
+#ifdef DEFERRED_LOG
+static const size_t _tx_size = 2 * _page_size; // Boot messages are kept in deferred log, so only errors are cached
+#else
 static const size_t _tx_size = 8 * _page_size; // Reserve 32K buffer to cache log messages on boot
+#endif
+static const size_t _line_size = 256;
+static const size_t _line_levels = 4;	// Thread level and nested INT handlers, deeper ones share the last line
+
+// Message which is being formatted on the core, it's sent to UART as a whole on
+// line break, so the messages of different cores are not mixed
+struct Console_Line
+{
+	char buf[_line_size];
+	size_t len;
+
+	llevel level;
+	bool isHex;
+	bool isFill;
+	bool isLevel;
+};
 
 enum systemKeys
 {
 	cmdMode = 0x09,		// 'CTRL + i' enter command mode
 	cmdBeep = 0x62,		// 'b': make a beep for testing purposes
+	cmdPause = 0x70,	// 'p': pause running VM and return to console
 	cmdShutdown = 0x73	// 's': shutdown running VM
 };
 
@@ -63,24 +83,35 @@ public:
 
 public:
 	void SetLevel(llevel);
+	void Flush(void);
+
+	void EnterIRq(void);
+	void LeaveIRq(void);
 
 private:
 	Console& SignedToStr(int64_t num, uint8_t fillSize = 0);
 	Console& UnsignedToStr(uint64_t num, uint8_t fillSize = 0);
 
-	inline void ShowLogLevel(void);
+	inline void ShowLogLevel(Console_Line& line);
+
+	// Line of the calling core at current INT nesting level
+	inline Console_Line& Line(void);
+	// Message is filtered by console level, so the formatting is skipped
+	inline bool Suppressed(Console_Line& line);
+
+	void Put(Console_Line& line, const char* str, size_t len);
+	void Commit(Console_Line& line);
 
 private:
 	bool isActive;
-	bool isHex;
-	bool isFill;
-	bool isLevel;
 
 	IUartDevice* uart;
 
-	llevel currentMsgLevel;
 	llevel consoleLevel;
 
+	Console_Line (&lines)[_max_cpus][_line_levels];
+	size_t lineLevel[_max_cpus];
+
 	// RX/TX buffering
 	RingBuffer<char, _rx_size> *rxBuffer;
 	RingBuffer<char, _tx_size> *txBuffer;
@@ -14,6 +14,9 @@
 
 #include <arm64/registers>
 #include <core/iconsole>
+#include <core/idlog>
+#include <fault>
+#include <system>
 
 namespace saturn {
 namespace core {
@@ -24,18 +27,21 @@ CpuInfo::CpuInfo()
 
 	if (mpidr & (1 << 30))
 	{
-		Info() << "found single processor system" << fmt::endl;
+		DInfo("found single processor system");
 		CoreId = 0;
 	}
 	else
 	{
-		Info() << "found SMP system" << fmt::endl;
-		uint64_t affinity = mpidr & 0xff00ffffff;
+		DInfo("found SMP system");
 
-		// TBD: let's limit to 16 cores only. It needs more investigation later
-		//      how to properly handle SMP
-		CoreId = affinity & 0xf;
-		Info() << "register CPU core " << CoreId << fmt::endl;
+		// TBD: only single cluster is supported, so the core is identified by Aff0
+		CoreId = mpidr & 0xff;
+		DInfo("register CPU core %u", CoreId);
+	}
+
+	if (CoreId >= _max_cpus)
+	{
+		Fault("boot CPU is out of supported range");
 	}
 }
 
@@ -0,0 +1,167 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#include "dlog.hpp"
+
+#include <arm64/atomic>
+#include <arm64/registers>
+#include <core/idlog>
+#include <sync/spinlock>
+
+#ifdef DEFERRED_LOG
+// Deferred log rings of all the cores. The symbol is global to be found by host tool,
+// so the rings could be decoded from raw memory dump as well.
+saturn::core::DLog_Ring dlog_buffer[saturn::_max_cpus];
+#endif // DEFERRED_LOG
+
+namespace saturn {
+namespace core {
+
+#ifdef DEFERRED_LOG
+
+// Log is used before per-CPU areas are initialized, so rings are indexed by MPIDR
+static inline DLog_Ring& Local_Ring(size_t& cpu)
+{
+	cpu = (Read_Mpidr() & 0xff) % _max_cpus;
+
+	return dlog_buffer[cpu];
+}
+
+void DLog_Record(llevel level, const char* format, size_t nargs, const uint64_t* args)
+{
+	size_t cpu;
+	DLog_Ring& ring = Local_Ring(cpu);
+
+	// Only INT handlers of the same core write to the ring, so masking is enough and
+	// the record is reserved without atomic operations.
+	uint64_t flags = sync::Local_IRq_Save();
+
+	uint64_t slot = ring.head;
+	ring.head = slot + 2 + nargs;
+
+	volatile uint64_t& header = ring.words[slot & (_dlogWords - 1)];
+	header = 0;
+
+	ring.words[(slot + 1) & (_dlogWords - 1)] = Read_Counter();
+
+	for (size_t i = 0; i < nargs; i++)
+	{
+		ring.words[(slot + 2 + i) & (_dlogWords - 1)] = args[i];
+	}
+
+	// '.dlog' section starts from 0, so the address of the string is its offset
+	Store_Release(&header, (_dlogMagic << 48) | (static_cast<uint64_t>(cpu) << 40) |
+			       (static_cast<uint64_t>(level) << 36) | (static_cast<uint64_t>(nargs) << 32) |
+			       (reinterpret_cast<uint64_t>(format) & 0xffffffff));
+
+	sync::Local_IRq_Restore(flags);
+}
+
+void DLog_Dump(void)
+{
+	// Decoder converts timestamps by the counter frequency
+	Raw() << "dlog: begin freq " << fmt::dec << ReadArm64Reg(CNTFRQ_EL0) << fmt::endl;
+
+	for (size_t cpu = 0; cpu < _max_cpus; cpu++)
+	{
+		DLog_Ring& ring = dlog_buffer[cpu];
+		uint64_t head = ring.head;
+		uint64_t slot = (head > _dlogWords) ? head - _dlogWords : 0;
+
+		// The first record could be partially overwritten, decoder looks for the next header
+		Raw() << "dlog: cpu " << cpu << " head " << head << fmt::endl;
+
+		while (slot < head)
+		{
+			Raw() << "dlog:" << fmt::hex;
+
+			for (size_t i = 0; (i < 4) && (slot < head); i++, slot++)
+			{
+				Raw() << " 0x" << ring.words[slot & (_dlogWords - 1)];
+			}
+
+			Raw() << fmt::dec << fmt::endl;
+		}
+	}
+
+	Raw() << "dlog: end" << fmt::endl;
+}
+
+#else // DEFERRED_LOG
+
+// Maximum length of the text printed at once
+static const size_t _pieceSize = 64;
+
+void DLog_Record(llevel level, const char* format, size_t nargs, const uint64_t* args)
+{
+	IConsole& con = iConsole() << level;
+	char piece[_pieceSize + 1];
+	size_t len = 0;
+	size_t n = 0;
+
+	auto flush = [&con, &piece, &len]()
+	{
+		if (len > 0)
+		{
+			piece[len] = 0;
+			con << piece;
+			len = 0;
+		}
+	};
+
+	for (const char* c = format; *c != 0; c++)
+	{
+		if ((*c != '%') || (c[1] == 0) || (c[1] == '%'))
+		{
+			c += (*c == '%') && (c[1] == '%');
+			piece[len++] = *c;
+
+			if (_pieceSize == len)
+			{
+				flush();
+			}
+
+			continue;
+		}
+
+		flush();
+
+		uint64_t value = (n < nargs) ? args[n++] : 0;
+
+		switch (*++c)
+		{
+		case 'd':
+			con << fmt::dec << static_cast<int64_t>(value);
+			break;
+		case 'u':
+			con << fmt::dec << value;
+			break;
+		case 'x':
+			con << fmt::hex << value << fmt::dec;
+			break;
+		case 'c':
+			con << static_cast<char>(value);
+			break;
+		default:
+			con << '%' << *c;
+			break;
+		}
+	}
+
+	flush();
+	con << fmt::endl;
+}
+
+#endif // DEFERRED_LOG
+
+}; // namespace core
+}; // namespace saturn
@@ -0,0 +1,47 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include <basetypes>
+#include <system>
+
+namespace saturn {
+namespace core {
+
+// Number of 64-bit words in ring of each core, must be power of 2
+static const size_t _dlogWords = 512;
+
+// Record layout, it's parsed by scripts/log_decode.py and must be kept in sync:
+//
+//  word 0: header
+//
+//   63         48 47    40 39 38 37 36 35   32 31                    0
+//    ____________ ________ _____ _____ ______ _______________________
+//   |    magic   |   CPU  | RES | lvl | args |   format string offset |
+//   '------------'--------'-----'-----'------'-----------------------'
+//
+//  word 1: CNTPCT_EL0
+//  word 2..: arguments
+//
+// Header is written last, so incomplete record has no magic.
+static const uint64_t _dlogMagic = 0xd106;
+
+struct DLog_Ring
+{
+	uint64_t	head;		// Total number of written words
+	uint64_t	reserved[7];	// Keep the words cache line aligned
+	volatile uint64_t words[_dlogWords];
+} __align(64);
+
+}; // namespace core
+}; // namespace saturn
@@ -16,15 +16,25 @@
 #include <arm64/registers>
 #include <core/iconsole>
 #include <core/iic>
+#include <core/itrace>
 #include <core/ivmm>
+#include <core/iwork>
+#include <hypercall>
+#include <percpu>
 
 extern saturn::uint64_t saturn_vector;
+extern saturn::PerCpu<saturn::uint64_t> irq_nesting;
 
 namespace saturn {
 namespace core {
 
-// Static pointer to the saved context. It will simplify access to context from different parts of Saturn
-static AArch64_Regs* Current_Context = nullptr;
+// Exception classes (ESR_EL2.EC) handled for guest partitions
+static const uint64_t _ec_wfx = 0x01;
+static const uint64_t _ec_fp_access = 0x07;
+static const uint64_t _ec_hvc64 = 0x16;
+
+// Static pointer to the saved context of each core. It will simplify access to context from different parts of Saturn
+static PerCpu<AArch64_Regs*> Current_Context __percpu;
 
 void Exceptions_Init()
 {
@@ -109,8 +119,32 @@ static void Print_Sys_Frame(struct AArch64_Regs* Regs)
 	      << fmt::endl;
 }
 
+// Hypervisor calls which are not served by exception fast path in vector.S
+static void Do_Hypercall(struct AArch64_Regs* Regs)
+{
+	switch (Regs->x0)
+	{
+	case _hvc_ping:
+	case _hvc_ping_full:
+		Regs->x0 = 0;
+		break;
+	default:
+		Regs->x0 = _hvc_not_supported;
+		break;
+	}
+}
+
+// Exception was taken from EL1 or EL0, i.e. from guest partition
+static inline bool Guest_Frame(struct AArch64_Regs* Regs)
+{
+	return ((Regs->cpsr_el2 >> 2) & 0x3) < 2;	// M[3:2] holds exception level
+}
+
 static void Fault_Mode(struct AArch64_Regs* Regs, bool SysMode)
 {
+	// Execution is stopped with INTs masked, so TX INT would never drain the output
+	iConsole().Flush();
+
 	Print_Hyp_Frame(Regs);
 
 	if (SysMode)
@@ -146,31 +180,96 @@ void System_Error(struct AArch64_Regs* Regs)
 
 void IRq_Handler(struct AArch64_Regs* Regs)
 {
+	// IRq could preempt another one, so keep the context of interrupted handler
+	AArch64_Regs* Prev_Context = *core::Current_Context;
 	core::Current_Context = Regs;
 
+	bool guest = (1 == *irq_nesting) && core::Guest_Frame(Regs);
+
+	core::iConsole().EnterIRq();
+
+	if (guest)
+	{
+		core::Trace(core::tevent::guest_exit, core::_trace_ec_irq, 0, Regs->pc_el2);
+	}
+
 	core::iIC().Handle_IRq();
 
-	// Check if there is signal to stop VM
-	if (core::iVMM().Get_VM_State() == core::vm_state::request_shutdown)
+	core::Current_Context = Prev_Context;
+
+	// Deferred work of the handlers is executed by the outermost handler with INTs
+	// unmasked, so it could be preempted by any INT
+	if (1 == *irq_nesting)
 	{
-		core::iVMM().Stop_VM();
+		core::iIC().Local_IRq_Enable();
+		core::iWork().Run_Work();
+		core::iIC().Local_IRq_Disable();
+	}
+
+	core::iConsole().LeaveIRq();
+
+	// Check if the partition should leave the core: VM is paused or stopped, or
+	// its time window is over. This could be done only by outermost handler which
+	// interrupted the partition, because guest exit abandons the IRq stack.
+	if (guest)
+	{
+		core::vcpu_exit reason = core::iVMM().Pending_Exit();
+
+		if (core::vcpu_exit::none != reason)
+		{
+			core::iVMM().Exit_VM(*Regs, reason);
+		}
+
+		core::Trace(core::tevent::guest_enter, core::Current_VM(), Regs->pc_el2);
 	}
 }
 
 void Guest_Abort(struct AArch64_Regs* Regs)
 {
+	uint64_t esr = ReadArm64Reg(ESR_EL2);
+	uint64_t ec = (esr >> 26) & 0x3f;
+
 	core::Current_Context = Regs;
 
+	core::Trace(core::tevent::guest_exit, ec, esr, Regs->pc_el2);
+
+	if (core::_ec_wfx == ec)
+	{
+		// Guest continues after the instruction once it's scheduled again. ISS.TI
+		// distinguishes WFI (0) and WFE (1).
+		Regs->pc_el2 += 4;
+		core::iVMM().Exit_VM(*Regs, (esr & 0x3) ? core::vcpu_exit::yield : core::vcpu_exit::idle);
+	}
+	else
+	if (core::_ec_fp_access == ec)
+	{
+		// The instruction is executed again once the partition owns FP/SIMD registers
+		core::iVMM().Switch_FP();
+	}
+	else
+	if (core::_ec_hvc64 == ec)
+	{
+		// Return address already points to the next instruction
+		core::Do_Hypercall(Regs);
+	}
+	else
 	if (saturn::core::Do_Memory_Trap(Regs) == false)
 	{
 		core::Error() << "Exception: Guest Abort" << core::fmt::endl;
-		core::Fault_Mode(Regs, true);
+		core::Print_Hyp_Frame(Regs);
+		core::Print_Sys_Frame(Regs);
+
+		// Hypervisor state is not affected, so return to VM manager
+		core::iVMM().Exit_VM(*Regs, core::vcpu_exit::fault);
 	}
 	else
 	{
 		// Trap handled, skip current EL1 instruction
 		Regs->pc_el2 += 4;
 	}
+
+	// Partition exit doesn't return here
+	core::Trace(core::tevent::guest_enter, core::Current_VM(), Regs->pc_el2);
 }
 
 void Guest_Error(struct AArch64_Regs* Regs)
@@ -21,10 +21,10 @@ namespace core {
 
 // (!) Heap part for MMU.
 // Note: we can't use Data_Block_List here because MMU requires pages to be aligned, what is not
-// possible within the structure mentioned above, because one element size is (_page_size + 16).
+// possible within the structure mentioned above, because one element size is (_page_size + token).
 // So let's manually create this special list for MMU.
 static Data_Block<_page_size>    _mmu_pages[_l3_tables] __section(".heap") __align(_page_size);
-static lib::List<void*>::Element _mmu_pool[_l3_tables]  __section(".heap");
+static Data_Token                _mmu_pool[_l3_tables]  __section(".heap");
 
 // (!) Heap pre-allocated data pools, must be used as carefully
 static Data_Block_List<16> _pool16[_heap_size] __section(".heap");
@@ -36,11 +36,37 @@ static Data_Block_List<64> _pool64[_heap_size] __section(".heap");
 const void* _heap_start = &_mmu_pages[0];
 
 Data_Pool::Data_Pool(size_t s)
-	: available(lib::Allocator_Type::none)
-	, allocated(lib::Allocator_Type::none)
+	: available()
+	, allocated()
 	, block_size(s)
+	, blocks(nullptr)
+	, tokens(nullptr)
+	, blockStride(0)
+	, tokenStride(0)
+	, count(0)
 {}
 
+void Data_Pool::Init(void* b, size_t bStride, Data_Token* t, size_t tStride, size_t n)
+{
+	blocks = static_cast<uint8_t*>(b);
+	tokens = reinterpret_cast<uint8_t*>(t);
+	blockStride = bStride;
+	tokenStride = tStride;
+	count = n;
+
+	// Pool memory is not cleared on boot, so all the token fields are set here
+	for (size_t i = 0; i < count; i++)
+	{
+		Data_Token* token = reinterpret_cast<Data_Token*>(tokens + i * tokenStride);
+
+		token->hook = lib::IList_Hook();
+		token->data = blocks + i * blockStride;
+		token->used = false;
+
+		available.push_back(*token);
+	}
+}
+
 size_t Data_Pool::Block_Size(void)
 {
 	return block_size;
@@ -51,16 +77,30 @@ bool Data_Pool::Has_Free_Block(void)
 	return (available.size() > 0);
 };
 
+Data_Token* Data_Pool::Token(void* base)
+{
+	// Address below the pool wraps around and fails the range check as well
+	uint64_t offset = reinterpret_cast<uint64_t>(base) - reinterpret_cast<uint64_t>(blocks);
+	Data_Token* token = nullptr;
+
+	if ((offset < blockStride * count) && (0 == (offset % blockStride)))
+	{
+		token = reinterpret_cast<Data_Token*>(tokens + (offset / blockStride) * tokenStride);
+	}
+
+	return token;
+}
+
 void* Data_Pool::Get_Block(void)
 {
 	void* block = nullptr;
+	Data_Token* token = available.pop_front();
 
-	if (available.size() > 0)
+	if (nullptr != token)
 	{
-		auto it = available.begin();
-		available.pop_front();
-		allocated.push_back(it.raw());
-		block = *it;
+		token->used = true;
+		allocated.push_back(*token);
+		block = token->data;
 	}
 
 	return block;
@@ -69,12 +109,13 @@ void* Data_Pool::Get_Block(void)
 bool Data_Pool::Free_Block(void* base)
 {
 	bool ret = false;
-	auto it = allocated.find(base);
+	Data_Token* token = Token(base);
 
-	if (it != allocated.end())
+	if ((nullptr != token) && token->used)
 	{
-		allocated.erase(it);
-		available.push_back(it.raw());
+		token->used = false;
+		allocated.remove(*token);
+		available.push_back(*token);
 		ret = true;
 	}
 
@@ -88,86 +129,36 @@ void Data_Pool::State(void)
 	Log() << "    available = " << available.size() << fmt::endl;
 	for (auto it = available.begin(); it != available.end(); ++it)
 	{
-		Log() << "      0x" << fmt::hex << fmt::fill << (uint64_t)*it << fmt::endl;
+		Log() << "      0x" << fmt::hex << fmt::fill << (uint64_t)it->data << fmt::endl;
 	}
 
 	Log() << "    allocated = " << allocated.size() << fmt::endl;
 	for (auto it = allocated.begin(); it != allocated.end(); ++it)
 	{
-		Log() << "      0x" << fmt::hex << fmt::fill << (uint64_t)*it << fmt::endl;
+		Log() << "      0x" << fmt::hex << fmt::fill << (uint64_t)it->data << fmt::endl;
 	}
 }
 
-template<typename T, size_t S = _heap_size>
-static void Pool_Init(T (&pool)[])
+template<size_t N>
+static void Pool_Init(Data_Pool& pool, Data_Block_List<N> (&list)[_heap_size])
 {
-	for (int i = 0; i < S; ++i)
-	{
-		auto& e = pool[i].element;
-
-		if (i > 0)
-		{
-			e.prev = &pool[i - 1].element;
-		}
-
-		if (i < (S - 1))
-		{
-			e.next = &pool[i + 1].element;
-		}
-
-		e.data = &pool[i].data;
-	}
-}
-
-template<typename T, size_t S = _heap_size>
-static void Pool_Init(lib::List<void*>::Element (&elements)[], T (&blocks)[])
-{
-	for (int i = 0; i < S; ++i)
-	{
-		auto& e = elements[i];
-		auto& data = blocks[i];
-
-		if (i > 0)
-		{
-			e.prev = &elements[i - 1];
-		}
-
-		if (i < (S - 1))
-		{
-			e.next = &elements[i + 1];
-		}
-
-		e.data = &data;
-	}
+	pool.Init(&list[0].data, sizeof(list[0]), &list[0].token, sizeof(list[0]), _heap_size);
 }
 
-
 void Heap::Data_Pools_Init(void)
 {
-	using dbl16 = Data_Block_List<16>;
-	Pool_Init<dbl16>(_pool16);
-	pool16.available.assign(&_pool16[0].element, &_pool16[_heap_size - 1].element);
-
-	using dbl32 = Data_Block_List<32>;
-	Pool_Init<dbl32>(_pool32);
-	pool32.available.assign(&_pool32[0].element, &_pool32[_heap_size - 1].element);
+	Pool_Init(pool16, _pool16);
+	Pool_Init(pool32, _pool32);
+	Pool_Init(pool48, _pool48);
+	Pool_Init(pool64, _pool64);
 
-	using dbl48 = Data_Block_List<48>;
-	Pool_Init<dbl48>(_pool48);
-	pool48.available.assign(&_pool48[0].element, &_pool48[_heap_size - 1].element);
-
-	using dbl64 = Data_Block_List<64>;
-	Pool_Init<dbl64>(_pool64);
-	pool64.available.assign(&_pool64[0].element, &_pool64[_heap_size - 1].element);
-
-	using dbl4k = Data_Block<_page_size>;
-	Pool_Init<dbl4k, _l3_tables>(_mmu_pool, _mmu_pages);
-	pool4k.available.assign(&_mmu_pool[0], &_mmu_pool[_heap_size - 1]);
+	pool4k.Init(_mmu_pages, sizeof(_mmu_pages[0]), _mmu_pool, sizeof(_mmu_pool[0]), _l3_tables);
 }
 
 // Heap class implementation
 Heap::Heap(void)
-	: pool16(16)
+	: lock()
+	, pool16(16)
 	, pool32(32)
 	, pool48(48)
 	, pool64(64)
@@ -178,6 +169,7 @@ Heap::Heap(void)
 
 void* Heap::Alloc(size_t size)
 {
+	sync::Lock_Guard guard(lock);
 	void* block = nullptr;
 
 	if (size <= pool16.Block_Size() && pool16.Has_Free_Block())
@@ -210,6 +202,8 @@ void* Heap::Alloc(size_t size)
 
 void Heap::Free(void *base)
 {
+	sync::Lock_Guard guard(lock);
+
 	if (pool16.Free_Block(base) ||
 	    pool32.Free_Block(base) ||
 	    pool48.Free_Block(base) ||
@@ -220,6 +214,8 @@ void Heap::Free(void *base)
 
 void Heap::State(void)
 {
+	sync::Lock_Guard guard(lock);
+
 	Log() << "Saturn heap state:" << fmt::endl;
 
 	pool16.State();
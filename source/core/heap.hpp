@@ -13,7 +13,8 @@
 #pragma once
 
 #include <core/iheap>
-#include <lib/list>
+#include <lib/ilist>
+#include <sync/spinlock>
 
 namespace saturn {
 namespace core {
@@ -25,12 +26,22 @@ struct Data_Block
 	char raw[_block_size];
 };
 
-// Data block list token
+// Token of the data block, it's linked to the lists of the pool
+struct Data_Token
+{
+	lib::IList_Hook hook;
+	void* data;
+	bool used;
+};
+
+using Data_Token_List = lib::IList<Data_Token, &Data_Token::hook>;
+
+// Data block with its token
 template <size_t _block_size>
 struct Data_Block_List
 {
 	Data_Block<_block_size> data;
-	lib::List<void*>::Element element;
+	Data_Token token;
 };
 
 // Data pool which manages the blocks
@@ -39,6 +50,11 @@ class Data_Pool
 public:
 	Data_Pool(size_t s);
 
+public:
+	// Blocks and tokens are arrays with own strides, so the token of the block is
+	// found by its address without search
+	void Init(void* blocks, size_t blockStride, Data_Token* tokens, size_t tokenStride, size_t count);
+
 public:
 	inline size_t Block_Size(void);
 	inline bool Has_Free_Block(void);
@@ -48,10 +64,20 @@ public:
 public:
 	void State(void);
 
+private:
+	Data_Token* Token(void* base);
+
 public:
-	lib::List<void*> available;
-	lib::List<void*> allocated;
+	Data_Token_List available;
+	Data_Token_List allocated;
 	size_t block_size;
+
+private:
+	uint8_t* blocks;
+	uint8_t* tokens;
+	size_t blockStride;
+	size_t tokenStride;
+	size_t count;
 };
 
 // Heap orchestrator
@@ -72,6 +98,9 @@ private:
 	void	Data_Pools_Init();
 
 private:
+	// Pools could be accessed by all the cores and from INT handlers
+	sync::Spinlock lock;
+
 	Data_Pool pool16;
 	Data_Pool pool32;
 	Data_Pool pool48;
@@ -0,0 +1,257 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#include "hyp_timer.hpp"
+
+#include <arm64/registers>
+#include <core/iconsole>
+#include <core/idlog>
+#include <core/icpu>
+#include <core/iic>
+#include <percpu>
+#include <sync/spinlock>
+
+namespace saturn {
+namespace core {
+
+static const uint64_t _noDeadline = ~0ULL;
+
+// TBD: ugly way to have access from static function to class instance
+static Hyp_Timer* thisTimer = nullptr;
+
+static PerCpu<Timer_Queue> timerQueue __percpu;
+
+Hyp_Timer::Hyp_Timer()
+{
+	thisTimer = this;
+	freq = ReadArm64Reg(CNTFRQ_EL0);
+
+	Cpu_Init();
+
+	iIC().Register_IRq_Handler(_hyp_timer_int, IRq_Handler);
+
+	DInfo("timer: EL2 physical timer, %u Hz", freq);
+}
+
+void Hyp_Timer::Cpu_Init(void)
+{
+	Timer_Queue& q = *timerQueue;
+
+	q.nrEvents = 0;
+	q.programmed = _noDeadline;
+
+	// Timer is armed only while there are queued events
+	WriteArm64Reg(CNTHP_CTL_EL2, 0);
+
+	// PPI configuration is banked per core
+	iIC().Set_IRq_Priority(_hyp_timer_int, IRqPriority::Critical);
+	iIC().IRq_Enable(_hyp_timer_int);
+}
+
+void Hyp_Timer::Sift_Up(Timer_Queue& q, size_t pos)
+{
+	Timer_Event* event = q.heap[pos];
+
+	while (pos > 0)
+	{
+		size_t parent = (pos - 1) / 2;
+
+		if (q.heap[parent]->deadline <= event->deadline)
+		{
+			break;
+		}
+
+		q.heap[pos] = q.heap[parent];
+		q.heap[pos]->slot = pos;
+		pos = parent;
+	}
+
+	q.heap[pos] = event;
+	event->slot = pos;
+}
+
+void Hyp_Timer::Sift_Down(Timer_Queue& q, size_t pos)
+{
+	Timer_Event* event = q.heap[pos];
+
+	while (true)
+	{
+		size_t child = pos * 2 + 1;
+
+		if (child >= q.nrEvents)
+		{
+			break;
+		}
+
+		// Take the nearest of two children
+		if (((child + 1) < q.nrEvents) && (q.heap[child + 1]->deadline < q.heap[child]->deadline))
+		{
+			child++;
+		}
+
+		if (event->deadline <= q.heap[child]->deadline)
+		{
+			break;
+		}
+
+		q.heap[pos] = q.heap[child];
+		q.heap[pos]->slot = pos;
+		pos = child;
+	}
+
+	q.heap[pos] = event;
+	event->slot = pos;
+}
+
+void Hyp_Timer::Insert(Timer_Queue& q, Timer_Event* event)
+{
+	q.heap[q.nrEvents] = event;
+	Sift_Up(q, q.nrEvents++);
+}
+
+void Hyp_Timer::Remove(Timer_Queue& q, Timer_Event* event)
+{
+	size_t pos = event->slot;
+	Timer_Event* last = q.heap[--q.nrEvents];
+
+	event->slot = _timer_not_queued;
+
+	// Put the last event to the free position and restore the heap order
+	if (last != event)
+	{
+		q.heap[pos] = last;
+		last->slot = pos;
+
+		Sift_Up(q, pos);
+		Sift_Down(q, last->slot);
+	}
+}
+
+void Hyp_Timer::Program(Timer_Queue& q, bool force)
+{
+	uint64_t next = (q.nrEvents > 0) ? q.heap[0]->deadline : _noDeadline;
+
+	// Register writes are synchronized by barrier, so skip them if nothing changed
+	if ((next == q.programmed) && (false == force))
+	{
+		return;
+	}
+
+	if (next != _noDeadline)
+	{
+		WriteArm64Reg(CNTHP_CVAL_EL2, next);
+		WriteArm64Reg(CNTHP_CTL_EL2, 1);	// ENABLE, IMASK is cleared
+	}
+	else
+	{
+		WriteArm64Reg(CNTHP_CTL_EL2, 0);
+	}
+
+	q.programmed = next;
+}
+
+bool Hyp_Timer::Start(Timer_Event& event, uint64_t deadline, uint64_t period)
+{
+	uint64_t flags = sync::Local_IRq_Save();
+	Timer_Queue& q = *timerQueue;
+	bool ret = true;
+
+	if (_timer_not_queued != event.slot)
+	{
+		Remove(q, &event);
+	}
+
+	event.deadline = deadline;
+	event.period = period;
+
+	if ((q.nrEvents < _maxTimerEvents) && (nullptr != event.handler))
+	{
+		Insert(q, &event);
+		Program(q, false);
+	}
+	else
+	{
+		Error() << "timer: failed to queue event on CPU " << iCPU().Id() << fmt::endl;
+		ret = false;
+	}
+
+	sync::Local_IRq_Restore(flags);
+
+	return ret;
+}
+
+void Hyp_Timer::Stop(Timer_Event& event)
+{
+	uint64_t flags = sync::Local_IRq_Save();
+	Timer_Queue& q = *timerQueue;
+
+	// Periodic event could be stopped by own handler, so it must not be requeued
+	event.period = 0;
+
+	if (_timer_not_queued != event.slot)
+	{
+		Remove(q, &event);
+		Program(q, false);
+	}
+
+	sync::Local_IRq_Restore(flags);
+}
+
+bool Hyp_Timer::Pending(Timer_Event& event)
+{
+	return _timer_not_queued != event.slot;
+}
+
+uint64_t Hyp_Timer::Ticks(uint64_t us)
+{
+	return (us * freq) / 1000000;
+}
+
+void Hyp_Timer::IRq_Handler(uint32_t)
+{
+	uint64_t flags = sync::Local_IRq_Save();
+	Timer_Queue& q = *timerQueue;
+	uint64_t now = Read_Counter();
+
+	while ((q.nrEvents > 0) && (q.heap[0]->deadline <= now))
+	{
+		Timer_Event* event = q.heap[0];
+
+		thisTimer->Remove(q, event);
+		event->handler(event->arg);
+
+		// Next deadline is counted from the previous one, so the handler latency doesn't
+		// shift periodic events. If the timer was delayed for longer than a period, the
+		// missed deadlines are skipped.
+		if ((event->period > 0) && (_timer_not_queued == event->slot))
+		{
+			uint64_t next = event->deadline + event->period;
+
+			if (next <= now)
+			{
+				next += ((now - next) / event->period + 1) * event->period;
+			}
+
+			event->deadline = next;
+			thisTimer->Insert(q, event);
+		}
+
+		now = Read_Counter();
+	}
+
+	// Level-sensitive timer INT is asserted until the comparator is updated
+	thisTimer->Program(q, true);
+	sync::Local_IRq_Restore(flags);
+}
+
+}; // namespace core
+}; // namespace saturn
@@ -0,0 +1,70 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include <basetypes>
+#include <core/itimer>
+
+namespace saturn {
+namespace core {
+
+// Hypervisor physical timer INT
+static const uint32_t _hyp_timer_int = 26;
+
+// Maximum number of queued events on single core
+static const size_t _maxTimerEvents = 32;
+
+// Events of the core are kept in binary min-heap ordered by deadline, so the
+// nearest one is always on top. Timer INT handler and queue updates run with
+// INTs masked on the owning core, so no locking is needed.
+struct Timer_Queue
+{
+	Timer_Event* heap[_maxTimerEvents];
+	size_t nrEvents;
+
+	// Deadline which is written to CNTHP_CVAL_EL2
+	uint64_t programmed;
+};
+
+class Hyp_Timer : public ITimer
+{
+public:
+	// Register timer INT handler, must be created once IC is available
+	Hyp_Timer();
+
+public:
+	// Enable timer INT on the calling core
+	void Cpu_Init(void);
+
+public:
+	bool Start(Timer_Event& event, uint64_t deadline, uint64_t period);
+	void Stop(Timer_Event& event);
+	bool Pending(Timer_Event& event);
+	uint64_t Ticks(uint64_t us);
+
+private:
+	static void IRq_Handler(uint32_t);
+
+	void Insert(Timer_Queue& q, Timer_Event* event);
+	void Remove(Timer_Queue& q, Timer_Event* event);
+	void Sift_Up(Timer_Queue& q, size_t pos);
+	void Sift_Down(Timer_Queue& q, size_t pos);
+	// Program the timer to the nearest deadline, force is used after timer INT
+	void Program(Timer_Queue& q, bool force);
+
+private:
+	uint64_t freq;
+};
+
+}; // namespace core
+}; // namespace saturn
@@ -42,6 +42,10 @@ static const size_t _firstSGI = 0;
 static const size_t _firstPPI = _firstSGI + _nrSGIs;
 static const size_t _firstSPI = _firstPPI + _nrPPIs;
 
+// Special INTIDs are returned on acknowledge when there is no pending interrupt
+static const size_t _firstSpecial = 1020;
+static const size_t _lastSpecial = 1023;
+
 // TBD: let's limit SPI number to QEMU AArch64 configuration - 256 lines
 static const size_t _gicd_nr_lines = 256;
 
@@ -13,7 +13,7 @@
 #include "cpu_interface.hpp"
 
 #include <arm64/registers>
-#include <core/iconsole>
+#include <core/idlog>
 
 namespace saturn {
 namespace core {
@@ -24,7 +24,8 @@ CpuInterface::CpuInterface()
 	uint64_t reg = ReadICCReg(ICC_SRE_EL2);
 	WriteICCReg(ICC_SRE_EL2, reg | 1);
 
-	// Single priority group
+	// All the priority bits form group priority, so INT with higher priority
+	// (see IRqPriority) could preempt the running handler
 	WriteICCReg(ICC_BPR1_EL1, 0);
 
 	// Set priority mask to handle all interrupts
@@ -37,7 +38,7 @@ CpuInterface::CpuInterface()
 	// Enable Group1 interrupts
 	WriteICCReg(ICC_IGRPEN1_EL1, 1);
 
-	Info() << "  /CPU interface initialized" << fmt::endl;
+	DInfo("  /CPU interface initialized");
 }
 
 uint32_t CpuInterface::Read_Ack_IRq()
@@ -12,7 +12,7 @@
 
 #pragma once
 
-#include <basetypes>
+#include "config.hpp"
 
 namespace saturn {
 namespace core {
@@ -26,6 +26,12 @@ public:
 	uint32_t Read_Ack_IRq();
 	void Drop_Priority(uint32_t);
 	void Deactivate(uint32_t);
+
+public:
+	static inline bool Is_Special(uint32_t id)
+	{
+		return (id >= _firstSpecial) && (id <= _lastSpecial);
+	}
 };
 
 }; // namespace core
@@ -16,6 +16,7 @@
 #include <arm64/registers>
 #include <bsp/platform>
 #include <core/icpu>
+#include <core/idlog>
 #include <fault>
 #include <mops>
 
@@ -36,7 +37,7 @@ GicDistributor::GicDistributor()
 	Save_State();
 
 	uint32_t ArchRev = (Regs->Read<uint32_t>(Dist_Regs::PIDR2) >> 4) & 0x0f;
-	Info() << "  /found GICv" << ArchRev << fmt::endl;
+	DInfo("  /found GICv%u", ArchRev);
 
 	if (ArchRev != 3)
 	{
@@ -49,7 +50,7 @@ GicDistributor::GicDistributor()
 	// Maximum SPI INTID could be calculated by: 32 * (N + 1)
 	size_t ITLinesNumber = Regs->Read<uint32_t>(Dist_Regs::TYPER) & 0x1f;
 	linesNumber = 32 * (ITLinesNumber + 1);
-	Info() << "  /found " << linesNumber << " interrupt lines" << fmt::endl;
+	DInfo("  /found %u interrupt lines", linesNumber);
 
 	// So we have now:
 	//   SGIs: 0  - 15
@@ -98,7 +99,7 @@ GicDistributor::GicDistributor()
 		Regs->Write<uint32_t>(Dist_Regs::IROUTER + i * 8, affinity);
 	}
 
-	Info() << "  /distributor initialized" << fmt::endl;
+	DInfo("  /distributor initialized");
 }
 
 void GicDistributor::Send_SGI(uint32_t targetList, uint8_t id)
@@ -133,6 +134,24 @@ void GicDistributor::IRq_Disable(uint32_t id)
 	}
 }
 
+void GicDistributor::Set_Priority(uint32_t id, uint8_t prio)
+{
+	if ((id >= _firstSPI) && (id < linesNumber))
+	{
+		// Priority registers are byte-accessible
+		Regs->Write<uint8_t>(Dist_Regs::IPRIORITYR + id, prio);
+	}
+}
+
+void GicDistributor::Set_Affinity(uint32_t id, size_t cpu)
+{
+	if ((id >= _firstSPI) && (id < linesNumber))
+	{
+		// TBD: only Aff0 is used, broadcast routing (IRM) is disabled
+		Regs->Write<uint64_t>(Dist_Regs::IROUTER + id * 8, cpu & 0xff);
+	}
+}
+
 void GicDistributor::RW_Complete(void)
 {
 	// TBD: should we introduce timeout?
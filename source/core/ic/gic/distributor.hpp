@@ -66,6 +66,8 @@ public:
 	size_t Get_Max_Lines();
 	void IRq_Enable(uint32_t);
 	void IRq_Disable(uint32_t);
+	void Set_Priority(uint32_t, uint8_t);
+	void Set_Affinity(uint32_t, size_t);
 
 public:
 	void Load_State(GicDistRegs&);
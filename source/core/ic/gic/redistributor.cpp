@@ -15,21 +15,39 @@
 
 #include <arm64/registers>
 #include <bsp/platform>
-#include <core/iconsole>
+#include <core/idlog>
+#include <fault>
 #include <mops>
+#include <percpu>
 
 namespace saturn {
 namespace core {
 
-// Default boot state of GIC distributor. This state will be used
+// Default boot state of GIC redistributors. This state will be used
 // as initial for virtual GIC
-static GicRedistRegs _GicRedistBootState;
+static PerCpu<GicRedistRegs> _GicRedistBootState __percpu;
 
-GicRedistributor::GicRedistributor()
-	: bootState(_GicRedistBootState)
+// Each redistributor occupies two 64K frames: RD_base and SGI_base
+static const size_t _redist_frame_size = 0x20000;
+
+GicRedistributor::GicRedistributor(size_t cpu)
+	: bootState(*_GicRedistBootState)
 {
+	MMap::IO_Region region = _gic_redist_addr;
+
+	// Redistributors are laid out contiguously in order of CPU cores
+	region.Base += cpu * _redist_frame_size;
+	region.Size = _redist_frame_size;
+
 	// TBD: check return value
-	Regs = new MMap(MMap::IO_Region(_gic_redist_addr));
+	Regs = new MMap(region);
+
+	// Make sure that frame really belongs to the core (TYPER.Affinity_Value)
+	uint32_t affinity = Regs->Read<uint64_t>(Redist_Regs::TYPER) >> 32;
+	if ((affinity & 0xff) != cpu)
+	{
+		Fault("gic: redistributor affinity does not match CPU core");
+	}
 
 	// Save the GIC state before we modify it
 	Save_State();
@@ -48,7 +66,7 @@ GicRedistributor::GicRedistributor()
 		Regs->Write<uint32_t>(SGI_offset + Redist_Regs::IPRIORITYR + (i / 4) * 4, 0x40404040);
 	}
 
-	for (size_t i = _firstPPI; i < _nrPPIs; i += 4)
+	for (size_t i = _firstPPI; i < _firstPPI + _nrPPIs; i += 4)
 	{
 		Regs->Write<uint32_t>(SGI_offset + Redist_Regs::IPRIORITYR + (i / 4) * 4, 0x80808080);
 	}
@@ -67,7 +85,7 @@ GicRedistributor::GicRedistributor()
 	// TBD: should we introduce timeout?
 	while (Regs->Read<uint32_t>(Redist_Regs::CTRL) & (1 << 31));
 
-	Info() << "  /redistributor initialized" << fmt::endl;
+	DInfo("  /redistributor initialized");
 }
 
 void GicRedistributor::IRq_Enable(uint32_t id)
@@ -91,6 +109,15 @@ void GicRedistributor::IRq_Disable(uint32_t id)
 	}
 }
 
+void GicRedistributor::Set_Priority(uint32_t id, uint8_t prio)
+{
+	if (id < _firstSPI)
+	{
+		// Priority registers are byte-accessible
+		Regs->Write<uint8_t>(SGI_offset + Redist_Regs::IPRIORITYR + id, prio);
+	}
+}
+
 void GicRedistributor::RW_Complete(void)
 {
 	// TBD: should we introduce timeout?
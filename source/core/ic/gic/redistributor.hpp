@@ -49,11 +49,12 @@ public:
 	};
 
 public:
-	GicRedistributor();
+	GicRedistributor(size_t cpu);
 
 public:
 	void IRq_Enable(uint32_t id);
 	void IRq_Disable(uint32_t id);
+	void Set_Priority(uint32_t id, uint8_t prio);
 
 public:
 	void Load_State(GicRedistRegs&);
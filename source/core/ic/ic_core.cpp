@@ -11,6 +11,8 @@
 // specific language governing permissions and limitations under the License.
 
 #include "ic_core.hpp"
+#include "irq_storm.hpp"
+#include "irq_timing.hpp"
 
 #include "gic/config.hpp"
 #include "gic/cpu_interface.hpp"
@@ -20,17 +22,38 @@
 #include "virt/virt_ic.hpp"
 
 #include <arm64/registers>
+#include <core/icpu>
+#include <core/idlog>
+#include <core/itrace>
 #include <core/ivmm>
 #include <fault>
+#include <system>
 
 namespace saturn {
 namespace core {
 
+// External API:
+bool SMP_Cpu_Is_Online(size_t cpu);
+
 // TBD: think about better allocation for this data block
 static IRqHandler _IRq_Table[_maxIRq];
+static sync::Atomic_Bitmap<_maxIRq> _vmIRqMask;
+static uint8_t _vmIRqOwner[_maxIRq];
+
+static PerCpu<CpuInterface*> _CpuIface __percpu;
+static PerCpu<GicRedistributor*> _GicRedist __percpu;
+static PerCpu<GicVirtIC*> _GicVIC __percpu;
+static PerCpu<IRq_Stats> _Stats __percpu;
 
 IC_Core::IC_Core()
-	: IRq_Table(_IRq_Table)
+	: CpuIface(_CpuIface)
+	, GicRedist(_GicRedist)
+	, GicVIC(_GicVIC)
+	, IRq_Table(_IRq_Table)
+	, vmIRqMask(_vmIRqMask)
+	, vmIRqOwner(_vmIRqOwner)
+	, Stats(_Stats)
+	, statsTotal()
 {
 	// GICv3 consists from the following logical components:
 	//
@@ -42,9 +65,9 @@ IC_Core::IC_Core()
 	//
 	// So let's construct objects for the complete routing chain
 
-	// TBD: we should distinguish primary CPU and secondary.
-	//      GIC dist should be initialized only for primary CPU.
-	Info() << "create interrupts infrastructure" << fmt::endl;
+	// Distributor is shared between all the cores, so it's initialized only
+	// once by primary CPU. The rest of chain is set up by Cpu_Init() per core.
+	DInfo("create interrupts infrastructure");
 
 
 	GicDist = new GicDistributor();
@@ -53,28 +76,47 @@ IC_Core::IC_Core()
 		Fault("GIC distributor allocation failed");
 	}
 
-	GicRedist = new GicRedistributor();
-	if (nullptr == GicRedist)
+	for (int i = 0; i < GicDist->Get_Max_Lines(); i++)
 	{
-		Fault("GIC redistributor allocation failed");
+		IRq_Table[i] = Default_Handler;
 	}
 
-	CpuIface = new CpuInterface();
-	if (nullptr == CpuIface)
+	Timings = new IRqTimings();
+	if (nullptr == Timings)
 	{
-		Fault("GIC CPU interface allocation failed");
+		Fault("INT timings allocation failed");
 	}
 
-	for (int i = 0; i < GicDist->Get_Max_Lines(); i++)
+	Cpu_Init();
+
+	Storm = new IRqStorm(*this);
+	if (nullptr == Storm)
 	{
-		IRq_Table[i] = Default_Handler;
+		Fault("INT storm protection allocation failed");
 	}
+}
 
-	GicVIC = new GicVirtIC(*CpuIface, *GicDist, *GicRedist);
-	if (nullptr == GicVIC)
+void IC_Core::Cpu_Init()
+{
+	GicRedist = new GicRedistributor(iCPU().Id());
+	if (nullptr == *GicRedist)
+	{
+		Fault("GIC redistributor allocation failed");
+	}
+
+	CpuIface = new CpuInterface();
+	if (nullptr == *CpuIface)
+	{
+		Fault("GIC CPU interface allocation failed");
+	}
+
+	GicVIC = new GicVirtIC(Local_Iface(), *GicDist, Local_Redist(), *Timings);
+	if (nullptr == *GicVIC)
 	{
 		Fault("GIC virtual interface allocation failed");
 	}
+
+	Timings->Cpu_Init();
 }
 
 void IC_Core::Local_IRq_Disable()
@@ -101,7 +143,7 @@ void IC_Core::IRq_Enable(uint32_t nr)
 	{
 		if (nr < _firstSPI)
 		{
-			GicRedist->IRq_Enable(nr);
+			Local_Redist().IRq_Enable(nr);
 		}
 		else
 		{
@@ -116,7 +158,7 @@ void IC_Core::IRq_Disable(uint32_t nr)
 	{
 		if (nr < _firstSPI)
 		{
-			GicRedist->IRq_Disable(nr);
+			Local_Redist().IRq_Disable(nr);
 		}
 		else
 		{
@@ -125,6 +167,30 @@ void IC_Core::IRq_Disable(uint32_t nr)
 	}
 }
 
+void IC_Core::Set_IRq_Priority(uint32_t nr, IRqPriority prio)
+{
+	if (nr < _firstSPI)
+	{
+		Local_Redist().Set_Priority(nr, static_cast<uint8_t>(prio));
+	}
+	else
+	{
+		GicDist->Set_Priority(nr, static_cast<uint8_t>(prio));
+	}
+}
+
+void IC_Core::Set_IRq_Affinity(uint32_t nr, size_t cpu)
+{
+	if (cpu < _max_cpus)
+	{
+		GicDist->Set_Affinity(nr, cpu);
+	}
+	else
+	{
+		Error() << "error: attempt to route INT(" << nr << ") to invalid CPU " << cpu << fmt::endl;
+	}
+}
+
 void IC_Core::Send_SGI(uint32_t targetList, uint8_t id)
 {
 	if (id < _firstPPI)
@@ -139,28 +205,65 @@ void IC_Core::Send_SGI(uint32_t targetList, uint8_t id)
 
 void IC_Core::Handle_IRq()
 {
-	uint32_t nr = CpuIface->Read_Ack_IRq();
+	// INT is acknowledged on the core which took the exception
+	CpuInterface& Iface = Local_Iface();
+	GicVirtIC& VIC = Local_VIC();
+	IRq_Stats& stats = *Stats;
 
-	CpuIface->Drop_Priority(nr);
+	stats.exceptions++;
 
-	if ((iVMM().Get_VM_State() == vm_state::running) && (iVMM().Guest_IRq(nr)))
+	uint32_t nr = Iface.Read_Ack_IRq();
+
+	if (Iface.Is_Special(nr))
 	{
-		// VM is running and IRq assigned to the guest, so just route it
-		Inject_VM_IRq(nr, vINTtype::Hardware);
+		stats.spurious++;
 	}
-	else
+
+	// Drain all the pending INTs within single exception, so the cost of context
+	// save/restore and 'eret' is shared between them. The priority is dropped once
+	// INT is processed, so the next read returns the next pending INT if any.
+	while (false == Iface.Is_Special(nr))
 	{
-		// For all other cases handle IRq by hypervisor
-		if (nr < GicDist->Get_Max_Lines())
+		uint64_t ackTime = Read_Counter();
+
+		// Noisy line is masked for a while, but current instance is still processed
+		Storm->Account(nr, ackTime);
+
+		if ((nr < _maxIRq) && VM_IRq(nr))
 		{
-			IRq_Table[nr](nr);
+			// IRq assigned to the running guest, so just route it
+			Trace(tevent::irq_ack, nr, 1);
+			Iface.Drop_Priority(nr);
+			VIC.Inject_IRq(VM_IRq_Owner(nr, VIC), nr, vINTtype::Hardware);
+			Timings->Record(nr, IRqTimingType::Inject, Read_Counter() - ackTime);
+			stats.injected++;
 		}
 		else
 		{
-			Error() << "error: received INT with ID (" << nr << ") out of supported range" << fmt::endl;
+			// For all other cases handle IRq by hypervisor. The running priority is
+			// kept until handler completes, so only INTs with higher priority could
+			// preempt it.
+			if (nr < GicDist->Get_Max_Lines())
+			{
+				Trace(tevent::irq_ack, nr, 0, reinterpret_cast<uint64_t>(IRq_Table[nr]));
+
+				Local_IRq_Enable();
+				IRq_Table[nr](nr);
+				Local_IRq_Disable();
+
+				Timings->Record(nr, IRqTimingType::Handler, Read_Counter() - ackTime);
+			}
+			else
+			{
+				Error() << "error: received INT with ID (" << nr << ") out of supported range" << fmt::endl;
+			}
+
+			Iface.Drop_Priority(nr);
+			Iface.Deactivate(nr);
+			stats.handled++;
 		}
 
-		CpuIface->Deactivate(nr);
+		nr = Iface.Read_Ack_IRq();
 	}
 }
 
@@ -172,7 +275,7 @@ void IC_Core::Register_IRq_Handler(uint32_t id, IRqHandler handler)
 
 		if (id < 32)
 		{
-			GicRedist->IRq_Enable(id);
+			Local_Redist().IRq_Enable(id);
 		}
 		else
 		{
@@ -185,26 +288,101 @@ void IC_Core::Register_IRq_Handler(uint32_t id, IRqHandler handler)
 	}
 }
 
+void IC_Core::Set_IRq_Storm_Policy(uint64_t window, uint64_t mask, uint32_t overflows)
+{
+	Storm->Set_Policy(window, mask, overflows);
+}
+
+void IC_Core::Set_IRq_Rate_Limit(uint32_t nr, uint32_t max)
+{
+	Storm->Set_Limit(nr, max);
+}
+
+const IRq_Rate* IC_Core::Get_IRq_Rate(size_t idx)
+{
+	return Storm->Get(idx);
+}
+
+const IRq_Stats& IC_Core::Get_IRq_Stats()
+{
+	statsTotal = IRq_Stats();
+
+	// TBD: counters of other cores are read without locking, so the sum is approximate
+	for (size_t cpu = 0; cpu < _max_cpus; cpu++)
+	{
+		if (SMP_Cpu_Is_Online(cpu))
+		{
+			IRq_Stats& s = Stats.Get(cpu);
+
+			statsTotal.exceptions += s.exceptions;
+			statsTotal.spurious += s.spurious;
+			statsTotal.handled += s.handled;
+			statsTotal.injected += s.injected;
+			statsTotal.coalesced += s.coalesced;
+		}
+	}
+
+	return statsTotal;
+}
+
+const IRq_Timing* IC_Core::Get_IRq_Timing(size_t idx)
+{
+	return Timings->Get(idx);
+}
+
+void IC_Core::Reset_IRq_Timing()
+{
+	Timings->Reset();
+}
+
+void IC_Core::Set_IRq_Budget(uint64_t us)
+{
+	Timings->Set_Budget(us);
+}
+
+uint64_t IC_Core::Get_IRq_Budget()
+{
+	return Timings->Get_Budget();
+}
+
 void IC_Core::Default_Handler(uint32_t id)
 {
 	Error() << "warning: received INT with ID (" << id << ") without registered handler" << fmt::endl;
 }
 
-void IC_Core::Start_Virt_IC()
+size_t IC_Core::VM_IRq_Owner(uint32_t nr, GicVirtIC& vic)
+{
+	return (nr < _firstSPI) ? vic.Active_VM() : vmIRqOwner[nr];
+}
+
+void IC_Core::Start_Virt_IC(size_t vm)
+{
+	Local_VIC().Start(vm);
+}
+
+void IC_Core::Stop_Virt_IC(size_t vm)
+{
+	Local_VIC().Stop(vm);
+}
+
+void IC_Core::Switch_VM(size_t vm)
 {
-	GicVIC->Start();
+	Local_VIC().Switch_VM(vm);
 }
 
-void IC_Core::Stop_Virt_IC()
+bool IC_Core::VM_IRq_Pending(size_t vm)
 {
-	GicVIC->Stop();
+	return Local_VIC().IRq_Pending(vm);
 }
 
-void IC_Core::Inject_VM_IRq(uint32_t nr, vINTtype type)
+void IC_Core::Inject_VM_IRq(size_t vm, uint32_t nr, vINTtype type)
 {
 	if (iVMM().Get_VM_State() == vm_state::running)
 	{
-		GicVIC->Inject_IRq(nr, type);
+		if (Local_VIC().Inject_IRq(vm, nr, type))
+		{
+			Stats->coalesced++;
+		}
 	}
 	else
 	{	
@@ -212,5 +390,49 @@ void IC_Core::Inject_VM_IRq(uint32_t nr, vINTtype type)
 	}
 }
 
+void IC_Core::Assign_VM_IRq(uint32_t nr, size_t vm)
+{
+	if (nr < _maxIRq)
+	{
+		if ((nr >= _firstSPI) && VM_IRq(nr) && (vmIRqOwner[nr] != vm))
+		{
+			Error() << "error: INT(" << nr << ") is already assigned to VM" << vmIRqOwner[nr] << fmt::endl;
+		}
+		else
+		{
+			vmIRqOwner[nr] = vm;
+			vmIRqMask.Set(nr);
+			Set_IRq_Priority(nr, IRqPriority::Guest);
+		}
+
+		// Guest VM is started on the core where it runs, so keep its INTs local
+		Set_IRq_Affinity(nr, iCPU().Id());
+	}
+}
+
+void IC_Core::Release_VM_IRq(uint32_t nr)
+{
+	if (nr < _maxIRq)
+	{
+		vmIRqMask.Clear(nr);
+		Set_IRq_Priority(nr, IRqPriority::Default);
+	}
+}
+
+void IC_Core::Track_Guest_EOI(bool track)
+{
+	Local_VIC().Track_Guest_EOI(track);
+}
+
+uint64_t IC_Core::Get_Maintenance_Count()
+{
+	return Local_VIC().Get_Maintenance_Count();
+}
+
+uint64_t IC_Core::Get_Maintenance_Rate()
+{
+	return Local_VIC().Get_Maintenance_Rate();
+}
+
 }; // namespace core
 }; // namespace saturn
@@ -12,8 +12,12 @@
 
 #pragma once
 
+#include "gic/config.hpp"
+
 #include <core/iic>
 #include <core/ivirtic>
+#include <percpu>
+#include <sync/atomic_bitmap>
 
 namespace saturn {
 namespace core {
@@ -23,39 +27,107 @@ class CpuInterface;
 class GicDistributor;
 class GicRedistributor;
 class GicVirtIC;
+class IRqStorm;
+class IRqTimings;
 
 class IC_Core : public IIC, public IVirtIC
 {
 public:
 	IC_Core();
 
+public:
+	// Per-CPU part of initialization, must be called on each core
+	void Cpu_Init();
+
 // Saturn Core API:
 public:
 	void Local_IRq_Disable();
 	void Local_IRq_Enable();
 	void IRq_Enable(uint32_t);
 	void IRq_Disable(uint32_t);
+	void Set_IRq_Priority(uint32_t, IRqPriority);
+	void Set_IRq_Affinity(uint32_t, size_t);
 
 public:
 	void Send_SGI(uint32_t targetList, uint8_t id);
 	void Handle_IRq();
 	void Register_IRq_Handler(uint32_t, IRqHandler);
 
+public:
+	void Set_IRq_Storm_Policy(uint64_t, uint64_t, uint32_t);
+	void Set_IRq_Rate_Limit(uint32_t, uint32_t);
+	const IRq_Rate* Get_IRq_Rate(size_t);
+
+public:
+	const IRq_Stats& Get_IRq_Stats();
+	const IRq_Timing* Get_IRq_Timing(size_t);
+	void Reset_IRq_Timing();
+	void Set_IRq_Budget(uint64_t);
+	uint64_t Get_IRq_Budget();
+
 // Guest VM API:
 public:
-	void Start_Virt_IC();
-	void Stop_Virt_IC();
-	void Inject_VM_IRq(uint32_t, vINTtype);
+	void Start_Virt_IC(size_t);
+	void Stop_Virt_IC(size_t);
+	void Inject_VM_IRq(size_t, uint32_t, vINTtype);
+	void Switch_VM(size_t);
+	bool VM_IRq_Pending(size_t);
+	void Assign_VM_IRq(uint32_t, size_t);
+	void Release_VM_IRq(uint32_t);
+
+public:
+	void Track_Guest_EOI(bool);
+	uint64_t Get_Maintenance_Count();
+	uint64_t Get_Maintenance_Rate();
+
+private:
+	// Fast check in INT handling path, no need to ask VM manager
+	inline bool VM_IRq(uint32_t nr)
+	{
+		return vmIRqMask.Test(nr);
+	}
+
+	// PPIs are banked per core, so they belong to the partition loaded on the core
+	inline size_t VM_IRq_Owner(uint32_t nr, GicVirtIC& vic);
+
+	// Components which belong to the calling CPU core
+	inline CpuInterface& Local_Iface()
+	{
+		return **CpuIface;
+	}
+
+	inline GicRedistributor& Local_Redist()
+	{
+		return **GicRedist;
+	}
+
+	inline GicVirtIC& Local_VIC()
+	{
+		return **GicVIC;
+	}
 
 private:
-	CpuInterface* CpuIface;
 	GicDistributor* GicDist;
-	GicRedistributor* GicRedist;
 
-	GicVirtIC* GicVIC;
+	// CPU interface, redistributor and GIC virtualization are banked per core
+	PerCpu<CpuInterface*>& CpuIface;
+	PerCpu<GicRedistributor*>& GicRedist;
+	PerCpu<GicVirtIC*>& GicVIC;
+
+	IRqTimings* Timings;
+	IRqStorm* Storm;
 
 	IRqHandler (&IRq_Table)[];
 
+	// Bitmap of INTs routed to the running guest VM, it's modified by the core
+	// which starts VM and read by any core in INT handler
+	sync::Atomic_Bitmap<_maxIRq>& vmIRqMask;
+	uint8_t (&vmIRqOwner)[];
+
+	// Statistics are updated by each core and summed up on request
+	PerCpu<IRq_Stats>& Stats;
+	IRq_Stats statsTotal;
+
 private:
 	static void Default_Handler(uint32_t);
 };
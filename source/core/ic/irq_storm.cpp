@@ -0,0 +1,200 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#include "irq_storm.hpp"
+
+#include "gic/config.hpp"
+
+#include <arm64/registers>
+#include <core/iconsole>
+#include <core/itimer>
+#include <percpu>
+#include <sync/spinlock>
+
+namespace saturn {
+namespace core {
+
+// External API:
+bool SMP_Cpu_Is_Online(size_t cpu);
+
+// Masked lines are unmasked by the core which detected the storm
+static PerCpu<Timer_Event> stormTimer __percpu;
+
+static uint8_t _rateSlots[_maxIRq];
+static IRq_Rate _rates[_nrRateLimits];
+static PerCpu<IRqRateStates> _rateStates __percpu;
+
+IRqStorm::IRqStorm(IIC& ic)
+	: IC(ic)
+	, slots(_rateSlots)
+	, nrUsed(0)
+	, rates(_rates)
+	, states(_rateStates)
+{
+	freq = ReadArm64Reg(CNTFRQ_EL0);
+
+	Set_Policy(_defaultStormWindow, _defaultStormMask, _defaultStormOverflows);
+}
+
+void IRqStorm::Set_Policy(uint64_t window_us, uint64_t mask_us, uint32_t overflows)
+{
+	window = (window_us * freq) / 1000000;
+	mask = (mask_us * freq) / 1000000;
+	maxOverflows = overflows;
+}
+
+void IRqStorm::Set_Limit(uint32_t nr, uint32_t max)
+{
+	if (nr < _maxIRq)
+	{
+		if ((0 == slots[nr]) && (nrUsed < _nrRateLimits))
+		{
+			rates[nrUsed] = IRq_Rate();
+			rates[nrUsed].nr = nr;
+			slots[nr] = ++nrUsed;
+		}
+
+		if (slots[nr] > 0)
+		{
+			rates[slots[nr] - 1].limit = max;
+		}
+		else
+		{
+			Error() << "error: no free slots to limit INT(" << nr << ") rate" << fmt::endl;
+		}
+	}
+}
+
+const IRq_Rate* IRqStorm::Get(size_t idx)
+{
+	IRq_Rate* rate = nullptr;
+
+	if (idx < nrUsed)
+	{
+		rate = &rates[idx];
+		rate->total = 0;
+		rate->throttled = 0;
+		rate->masked = false;
+
+		// TBD: counters of other cores are read without locking, so the sum is approximate
+		for (size_t cpu = 0; cpu < _max_cpus; cpu++)
+		{
+			if (SMP_Cpu_Is_Online(cpu))
+			{
+				IRqRateState& r = states.Get(cpu)[idx];
+
+				rate->total += r.total;
+				rate->throttled += r.throttled;
+				rate->masked = rate->masked || r.masked;
+			}
+		}
+	}
+
+	return rate;
+}
+
+void IRqStorm::Account(uint32_t nr, uint64_t now)
+{
+	if ((nr < _maxIRq) && (slots[nr] > 0))
+	{
+		size_t slot = slots[nr] - 1;
+		uint32_t limit = rates[slot].limit;
+		IRqRateState& r = (*states)[slot];
+
+		if ((now - r.windowStart) >= window)
+		{
+			// Close the window, storm is detected only if overflow is sustained
+			r.overflows = (r.windowCount > limit) ? (r.overflows + 1) : 0;
+			r.windowStart = now;
+			r.windowCount = 0;
+		}
+
+		r.windowCount++;
+		r.total++;
+
+		if ((false == r.masked) && (r.windowCount > limit) && ((r.overflows + 1) >= maxOverflows))
+		{
+			// PPI is masked in redistributor of the core, so it's unmasked by the same core
+			IC.IRq_Disable(nr);
+
+			r.masked = true;
+			r.throttled++;
+			r.maskedUntil = now + mask;
+			r.overflows = 0;
+
+			Arm_Timer();
+		}
+	}
+}
+
+void IRqStorm::Unmask_Expired(void)
+{
+	uint64_t now = Read_Counter();
+
+	for (size_t i = 0; i < nrUsed; i++)
+	{
+		IRqRateState& r = (*states)[i];
+
+		if (r.masked && (now >= r.maskedUntil))
+		{
+			// Start accounting from scratch
+			r.windowStart = now;
+			r.windowCount = 0;
+			r.masked = false;
+
+			IC.IRq_Enable(rates[i].nr);
+		}
+	}
+}
+
+void IRqStorm::Arm_Timer(void)
+{
+	IRqRateStates& r = *states;
+	uint64_t next = ~0UL;
+
+	for (size_t i = 0; i < nrUsed; i++)
+	{
+		if (r[i].masked && (r[i].maskedUntil < next))
+		{
+			next = r[i].maskedUntil;
+		}
+	}
+
+	// Timer is armed only while there are masked lines
+	if (next != ~0UL)
+	{
+		stormTimer->handler = Timer_Handler;
+		stormTimer->arg = this;
+
+		iTimer().Start(*stormTimer, next, 0);
+	}
+	else
+	{
+		iTimer().Stop(*stormTimer);
+	}
+}
+
+void IRqStorm::Timer_Handler(void* arg)
+{
+	IRqStorm* storm = static_cast<IRqStorm*>(arg);
+
+	// Timer handler runs with INTs unmasked, but the state is updated by INT accounting
+	uint64_t flags = sync::Local_IRq_Save();
+
+	storm->Unmask_Expired();
+	storm->Arm_Timer();
+
+	sync::Local_IRq_Restore(flags);
+}
+
+}; // namespace core
+}; // namespace saturn
@@ -0,0 +1,86 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include <core/iic>
+#include <percpu>
+
+namespace saturn {
+namespace core {
+
+// Number of INTs which could have rate limit
+static const size_t _nrRateLimits = 16;
+
+// Default storm policy, could be overwritten by board configuration
+static const uint64_t _defaultStormWindow = 10000;	// Rate accounting window in microseconds
+static const uint64_t _defaultStormMask = 100000;	// Time to keep noisy INT masked in microseconds
+static const uint32_t _defaultStormOverflows = 3;	// Number of overflowed windows in a row to detect storm
+
+// Accounting state of the line is kept per core: PPIs are banked, so each core masks
+// and unmasks own instance, and SPI is accounted by the core which it's routed to
+struct IRqRateState
+{
+	uint64_t windowStart;	// Start of current accounting window
+	uint32_t windowCount;	// INTs received in current window
+	uint32_t overflows;	// Number of overflowed windows in a row
+	uint64_t maskedUntil;	// Time when the line should be unmasked
+
+	uint64_t total;		// INTs received by the core
+	uint64_t throttled;	// Number of times the line was masked by the core
+	bool masked;		// Line is masked by the core at the moment
+};
+
+using IRqRateStates = IRqRateState[_nrRateLimits];
+
+class IRqStorm
+{
+public:
+	IRqStorm(IIC&);
+
+public:
+	void Set_Policy(uint64_t window, uint64_t mask, uint32_t overflows);
+	void Set_Limit(uint32_t nr, uint32_t max);
+	const IRq_Rate* Get(size_t idx);
+
+public:
+	// Account INT occurrence, mask the line if storm is detected
+	void Account(uint32_t nr, uint64_t now);
+
+private:
+	void Unmask_Expired(void);
+	void Arm_Timer(void);
+
+private:
+	static void Timer_Handler(void* arg);
+
+private:
+	IIC& IC;
+
+	// INT ID to rate slot map, 0 means the INT is not limited
+	uint8_t (&slots)[];
+	size_t nrUsed;
+
+	// Limits are set once on boot, statistics of all the cores are summed up on request
+	IRq_Rate (&rates)[];
+	PerCpu<IRqRateStates>& states;
+
+	// Storm policy in ticks
+	uint64_t window;
+	uint64_t mask;
+	uint32_t maxOverflows;
+
+	uint64_t freq;
+};
+
+}; // namespace core
+}; // namespace saturn
@@ -0,0 +1,169 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#include "irq_timing.hpp"
+
+#include <arm64/registers>
+#include <core/icpu>
+#include <lib/bitmap>
+
+namespace saturn {
+namespace core {
+
+// External API:
+bool SMP_Cpu_Is_Online(size_t cpu);
+
+// Timing slots are allocated on the first INT occurrence, so the memory
+// is spent only for INTs which are really used
+static IRqTimingTable _timingTables[_max_cpus];
+static PerCpu<IRqTimingTable*> _localTimingTable __percpu;
+
+IRqTimings::IRqTimings()
+	: tables(_timingTables)
+	, localTable(_localTimingTable)
+	, total()
+{
+	freq = ReadArm64Reg(CNTFRQ_EL0);
+	Set_Budget(_defaultIRqBudget);
+}
+
+void IRqTimings::Cpu_Init(void)
+{
+	localTable = &tables[iCPU().Id()];
+}
+
+void IRqTimings::Record(uint32_t nr, IRqTimingType type, uint64_t ticks)
+{
+	IRqTimingTable& table = **localTable;
+
+	if (nr < _maxIRq)
+	{
+		if ((0 == table.slots[nr]) && (table.nrUsed < _nrTimedIRqs))
+		{
+			table.timings[table.nrUsed].nr = nr;
+			table.slots[nr] = ++table.nrUsed;
+		}
+
+		if (table.slots[nr] > 0)
+		{
+			IRq_Timing& t = table.timings[table.slots[nr] - 1];
+
+			switch (type)
+			{
+			case IRqTimingType::Handler:
+				t.handler.Add(ticks);
+				if (ticks > budget)
+				{
+					t.overruns++;
+				}
+				break;
+			case IRqTimingType::Inject:
+				t.inject.Add(ticks);
+				break;
+			case IRqTimingType::Guest:
+				t.guest.Add(ticks);
+				break;
+			}
+		}
+	}
+}
+
+const IRq_Timing* IRqTimings::Get(size_t idx)
+{
+	const IRq_Timing* ret = nullptr;
+	lib::Bitmap<_maxIRq> seen;
+	size_t nrSeen = 0;
+
+	// INTs are listed in order of the first occurrence on the cores starting from CPU 0
+	for (size_t cpu = 0; (cpu < _max_cpus) && (nullptr == ret); cpu++)
+	{
+		IRqTimingTable& table = tables[cpu];
+
+		if (false == SMP_Cpu_Is_Online(cpu))
+		{
+			continue;
+		}
+
+		for (size_t i = 0; (i < table.nrUsed) && (nullptr == ret); i++)
+		{
+			uint32_t nr = table.timings[i].nr;
+
+			if (seen.test(nr))
+			{
+				continue;
+			}
+
+			seen.set(nr);
+
+			if (nrSeen++ == idx)
+			{
+				ret = Sum(nr);
+			}
+		}
+	}
+
+	return ret;
+}
+
+const IRq_Timing* IRqTimings::Sum(uint32_t nr)
+{
+	total = IRq_Timing();
+	total.nr = nr;
+
+	// TBD: tables of other cores are read without locking, so the sum is approximate
+	for (size_t cpu = 0; cpu < _max_cpus; cpu++)
+	{
+		IRqTimingTable& table = tables[cpu];
+
+		if (SMP_Cpu_Is_Online(cpu) && (table.slots[nr] > 0))
+		{
+			IRq_Timing& t = table.timings[table.slots[nr] - 1];
+
+			total.handler.Merge(t.handler);
+			total.inject.Merge(t.inject);
+			total.guest.Merge(t.guest);
+			total.overruns += t.overruns;
+		}
+	}
+
+	return &total;
+}
+
+void IRqTimings::Reset(void)
+{
+	// TBD: other cores could update their tables at the same time
+	for (size_t cpu = 0; cpu < _max_cpus; cpu++)
+	{
+		IRqTimingTable& table = tables[cpu];
+
+		for (size_t i = 0; i < table.nrUsed; i++)
+		{
+			table.timings[i].handler.Reset();
+			table.timings[i].inject.Reset();
+			table.timings[i].guest.Reset();
+			table.timings[i].overruns = 0;
+		}
+	}
+}
+
+void IRqTimings::Set_Budget(uint64_t us)
+{
+	budget = (us * freq) / 1000000;
+}
+
+uint64_t IRqTimings::Get_Budget(void)
+{
+	return (budget * 1000000) / freq;
+}
+
+}; // namespace core
+}; // namespace saturn
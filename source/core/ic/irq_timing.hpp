@@ -0,0 +1,79 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include "gic/config.hpp"
+
+#include <core/iic>
+#include <percpu>
+
+namespace saturn {
+namespace core {
+
+// Number of INTs which could be tracked simultaneously
+static const size_t _nrTimedIRqs = 32;
+
+// Default handler budget in microseconds
+static const uint64_t _defaultIRqBudget = 100;
+
+enum class IRqTimingType
+{
+	Handler,	// Acknowledge to hypervisor handler exit
+	Inject,		// Acknowledge to LR write
+	Guest		// LR write to guest EOI
+};
+
+// Histograms are updated by INT path of each core, so every core has own table
+struct IRqTimingTable
+{
+	// INT ID to timing slot map, 0 means the INT is not tracked yet
+	uint8_t slots[_maxIRq];
+	IRq_Timing timings[_nrTimedIRqs];
+	size_t nrUsed;
+};
+
+class IRqTimings
+{
+public:
+	IRqTimings();
+
+public:
+	// Per-CPU part of initialization, must be called on each core
+	void Cpu_Init(void);
+
+public:
+	void Record(uint32_t nr, IRqTimingType type, uint64_t ticks);
+	// Timings of all the cores are summed up on request
+	const IRq_Timing* Get(size_t idx);
+	void Reset(void);
+
+public:
+	void Set_Budget(uint64_t us);
+	uint64_t Get_Budget(void);
+
+private:
+	const IRq_Timing* Sum(uint32_t nr);
+
+private:
+	IRqTimingTable (&tables)[];
+	PerCpu<IRqTimingTable*>& localTable;
+
+	// Sum of all the cores for requested INT
+	IRq_Timing total;
+
+	uint64_t budget;	// Handler budget in ticks
+	uint64_t freq;		// System counter frequency
+};
+
+}; // namespace core
+}; // namespace saturn
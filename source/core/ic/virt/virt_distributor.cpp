@@ -14,24 +14,26 @@
 
 #include <bitops>
 #include <bsp/platform>
-#include <core/iconsole>
+#include <core/idlog>
 #include <core/ivirtic>
 #include <core/ivmm>
+#include <system>
 
 namespace saturn {
 namespace core {
 
-static GicDistRegs _VGicDistState;
+// Each partition has own virtual distributor
+static GicDistRegs _VGicDistState[_max_vms];
 
-VirtGicDistributor::VirtGicDistributor(GicDistributor& dist)
+VirtGicDistributor::VirtGicDistributor(GicDistributor& dist, size_t vm)
 	: gicDist(dist)
-	, vGicState(_VGicDistState)
+	, vGicState(_VGicDistState[vm])
 {
 	mTrap = new MTrap(_gic_dist_addr, *this);
 
 	gicDist.Load_State(vGicState);
 
-	Info() << "vic: virtual distributor created" << fmt::endl;
+	DInfo("vic: virtual distributor created");
 }
 
 VirtGicDistributor::~VirtGicDistributor()
@@ -45,8 +47,7 @@ void VirtGicDistributor::Read(uint64_t reg, void* data, AccessSize size)
 {
 	using Regs = GicDistributor::Dist_Regs;
 
-	// DBG:
-	//Log() << "vgicd: read from register offset 0x" << fmt::hex << reg << fmt::endl;
+	DDbg("vgicd: read from register offset 0x%x", reg);
 
 	switch (reg)
 	{
@@ -163,8 +164,7 @@ void VirtGicDistributor::Read(uint64_t reg, void* data, AccessSize size)
 		}
 		else
 		{
-			// DBG:
-			//Log() << "vgicd: unsupported read from register offset 0x" << fmt::hex << fmt::fill << reg << fmt::endl;
+			DDbg("vgicd: unsupported read from register offset 0x%x", reg);
 		}
 	}
 }
@@ -173,8 +173,7 @@ void VirtGicDistributor::Write(uint64_t reg, void* data, AccessSize size)
 {
 	using Regs = GicDistributor::Dist_Regs;
 
-	// DBG:
-	//Log() << "vgicd: write value 0x" << fmt::hex << *static_cast<uint32_t*>(data) << " to register offset 0x" << reg << fmt::endl;
+	DDbg("vgicd: write value 0x%x to register offset 0x%x", *static_cast<uint32_t*>(data), reg);
 
 	switch (reg)
 	{
@@ -204,8 +203,7 @@ void VirtGicDistributor::Write(uint64_t reg, void* data, AccessSize size)
 			// TBD: multiple bits could be set
 			size_t nr = index * 32 + FirstSetBit(*val);
 
-			// DBG:
-			//Log() << "vgicd: set enable INT(" << nr << ")" << fmt::endl;
+			DDbg("vgicd: set enable INT(%u)", nr);
 
 			if ((iVMM().Get_VM_State() == vm_state::running) && (iVMM().Guest_IRq(nr)))
 			{
@@ -224,8 +222,7 @@ void VirtGicDistributor::Write(uint64_t reg, void* data, AccessSize size)
 			// TBD: multiple bits could be set
 			size_t nr = index * 32 + FirstSetBit(*val);
 
-			// DBG:
-			//Log() << "vgicd: clear enable INT(" << nr << ")" << fmt::endl;
+			DDbg("vgicd: clear enable INT(%u)", nr);
 
 			if ((iVMM().Get_VM_State() == vm_state::running) && (iVMM().Guest_IRq(nr)))
 			{
@@ -287,8 +284,7 @@ void VirtGicDistributor::Write(uint64_t reg, void* data, AccessSize size)
 		}
 		else
 		{
-			// DBG:
-			//Log() << "vgicd: unsupported write to register offset 0x" << fmt::hex << fmt::fill << reg << fmt::endl; 
+			DDbg("vgicd: unsupported write to register offset 0x%x", reg);
 		}
 	}
 }
@@ -22,7 +22,7 @@ namespace core {
 class VirtGicDistributor : public IVirtIO
 {
 public:
-	VirtGicDistributor(GicDistributor&);
+	VirtGicDistributor(GicDistributor&, size_t);
 	~VirtGicDistributor();
 
 public:
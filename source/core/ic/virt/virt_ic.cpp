@@ -11,59 +11,97 @@
 // specific language governing permissions and limitations under the License.
 
 #include "../gic/cpu_interface.hpp"
+#include "../irq_timing.hpp"
 #include "virt_distributor.hpp"
 #include "virt_redistributor.hpp"
 #include "virt_ic.hpp"
 
 #include <arm64/registers>
 #include <bitops>
+#include <core/idlog>
 #include <core/iic>
+#include <core/itrace>
 #include <core/ivmm>
 #include <fault>
+#include <mops>
+#include <percpu>
+#include <sync/spinlock>
 
 namespace saturn {
 namespace core {
 
 // Arm strongly recommends that maintenance interrupts are configured to use INTID 25.
 static const uint32_t _maintenance_int = 25;
-// TBD: ugly way to have access from static function to class instance
-static GicVirtIC* thisVIC = nullptr;
+// TBD: ugly way to have access from static function to class instance of each core
+static PerCpu<GicVirtIC*> thisVIC __percpu;
 
-GicVirtIC::GicVirtIC(CpuInterface& cpu, GicDistributor& dist, GicRedistributor& redist)
+static PerCpu<uint32_t[_maxLRs]> _lrINT __percpu;
+static PerCpu<uint64_t[_maxLRs]> _lrTime __percpu;
+
+// Partition runs only on one core, so the context is indexed by partition
+static VIC_Context _vmContext[_max_vms];
+
+// LR fields
+static const uint64_t _lr_state_shift = 62;
+static const uint64_t _lr_hw = (1UL << 61);
+static const uint64_t _lr_pintid_mask = (0x1fffUL << 32);
+static const uint64_t _lr_eoi = (1UL << 41);
+static const uint64_t _lr_pending = (1UL << 62);
+static const uint64_t _lr_active = (1UL << 63);
+
+GicVirtIC::GicVirtIC(CpuInterface& cpu, GicDistributor& dist, GicRedistributor& redist, IRqTimings& timings)
 	: CpuIface(cpu)
 	, GicDist(dist)
 	, GicRedist(redist)
-	, vGicDist(nullptr)
-	, vGicRedist(nullptr)
-	, vState(VICState::Stopped)
+	, vGicDist()
+	, vGicRedist()
+	, activeVM(_no_vm)
+	, vmContext(_vmContext)
+	, Timings(timings)
+	, lrINT(*_lrINT)
+	, lrTime(*_lrTime)
+	, lrDeactivate(0)
+	, trackEOI(false)
+	, maintenanceCount(0)
+	, startTime(0)
 {
+	// List registers are banked per core, so the object is created on the core it serves
 	thisVIC = this;
 	nrLRs = (ReadICCReg(ICH_VTR_EL2) & 0xf) + 1;
+	lrMask = (1UL << nrLRs) - 1;
 
-	Log() << "vic: found " << nrLRs << " LR registers" << fmt::endl;
+	DLog(log, "vic: found %u LR registers", nrLRs);
 }
 
-void GicVirtIC::Start(void)
+void GicVirtIC::Start(size_t vm)
 {
-	if (VICState::Stopped == vState)
+	VIC_Context& ctx = vmContext[vm];
+
+	if (VICState::Stopped == ctx.state)
 	{
-		vGicDist = new VirtGicDistributor(GicDist);
-		vGicRedist = new VirtGicRedistributor(GicRedist);
+		// Trap regions of virtual [re]distributor belong to the partition loaded on the core
+		vGicDist[vm] = new VirtGicDistributor(GicDist, vm);
+		vGicRedist[vm] = new VirtGicRedistributor(GicRedist, vm);
 		
-		if ((nullptr == vGicDist) || (nullptr == vGicRedist))
+		if ((nullptr == vGicDist[vm]) || (nullptr == vGicRedist[vm]))
 		{
-			vState = VICState::Failed;
+			ctx.state = VICState::Failed;
 			Fault("GIC virtual [re]distributor allocation failed");
 		}
 		else
 		{
 			iIC().Register_IRq_Handler(_maintenance_int, &MaintenanceIRqHandler);
+			iIC().Set_IRq_Priority(_maintenance_int, IRqPriority::Critical);
 
-			uint64_t hcr = (1 << 0);			// En bit
-			WriteICCReg(ICH_HCR_EL2, hcr);
-			WriteICCReg(ICH_VMCR_EL2, (1 << 9) | (1 << 1));	// VEOIM (EOI drop only), VENG1 (Group 1 INTs)
+			// Initial state is written to hardware when partition is loaded
+			MSet<uint8_t>(&ctx, sizeof(ctx), 0);
+			ctx.hcr = (1 << 0);			// En bit
+			ctx.vmcr = (1 << 9) | (1 << 1);		// VEOIM (EOI drop only), VENG1 (Group 1 INTs)
 
-			vState = VICState::Started;
+			maintenanceCount = 0;
+			startTime = Read_Counter();
+
+			ctx.state = VICState::Started;
 		}
 	}
 	else
@@ -73,18 +111,144 @@ void GicVirtIC::Start(void)
 	}
 }
 
-void GicVirtIC::Stop()
+void GicVirtIC::Stop(size_t vm)
+{
+	VIC_Context& ctx = vmContext[vm];
+
+	if (VICState::Started == ctx.state)
+	{
+		if (vm == activeVM)
+		{
+			Switch_VM(_no_vm);
+		}
+
+		delete vGicDist[vm];
+		vGicDist[vm] = nullptr;
+
+		delete vGicRedist[vm];
+		vGicRedist[vm] = nullptr;
+
+		ctx.state = VICState::Stopped;
+	}
+}
+
+void GicVirtIC::Save_State(VIC_Context& ctx)
+{
+	ctx.hcr = ReadICCReg(ICH_HCR_EL2);
+	ctx.vmcr = ReadICCReg(ICH_VMCR_EL2);
+	ctx.ap0r0 = ReadICCReg(ICH_AP0R0_EL2);
+	ctx.ap1r0 = ReadICCReg(ICH_AP1R0_EL2);
+
+	for (uint8_t i = 0; i < nrLRs; i++)
+	{
+		uint64_t lr = Get_LR(i);
+
+		// Physical PPIs are banked per core and could be shared by partitions (like
+		// virtual timer), so active PPI would block the next partition. Deactivate
+		// it now and keep the saved INT as software one.
+		if ((lr & _lr_hw) && (lr >> _lr_state_shift))
+		{
+			uint32_t pINTID = (lr & _lr_pintid_mask) >> 32;
+
+			if (pINTID < _firstSPI)
+			{
+				CpuIface.Deactivate(pINTID);
+				lr &= ~(_lr_hw | _lr_pintid_mask);
+			}
+		}
+
+		// The same for physical INT which waits for guest EOI of software instance
+		if (lrDeactivate & (1UL << i))
+		{
+			CpuIface.Deactivate(lrINT[i]);
+			lr &= ~_lr_eoi;
+		}
+
+		ctx.lr[i] = lr;
+		ctx.lrINT[i] = lrINT[i];
+		Set_LR(i, 0);
+	}
+
+	lrDeactivate = 0;
+
+	// Virtual CPU interface is disabled until the next partition is loaded
+	WriteICCReg(ICH_HCR_EL2, 0);
+}
+
+void GicVirtIC::Restore_State(VIC_Context& ctx)
+{
+	WriteICCReg(ICH_AP0R0_EL2, ctx.ap0r0);
+	WriteICCReg(ICH_AP1R0_EL2, ctx.ap1r0);
+	WriteICCReg(ICH_VMCR_EL2, ctx.vmcr);
+
+	for (uint8_t i = 0; i < nrLRs; i++)
+	{
+		lrINT[i] = ctx.lrINT[i];
+		Set_LR(i, ctx.lr[i]);
+	}
+
+	WriteICCReg(ICH_HCR_EL2, ctx.hcr);
+
+	// Deliver INTs which were received while partition was not loaded
+	for (size_t w = 0; w < _nrPendingWords; w++)
+	{
+		while (ctx.pending[w] > 0)
+		{
+			uint64_t bit = __builtin_ctzll(ctx.pending[w]);
+			uint64_t mask = 1UL << bit;
+			vINTtype type = (ctx.hwPending[w] & mask) ? vINTtype::Hardware : vINTtype::Software;
+
+			ctx.pending[w] &= ~mask;
+			ctx.hwPending[w] &= ~mask;
+
+			Inject_IRq(activeVM, w * 64 + bit, type);
+		}
+	}
+}
+
+void GicVirtIC::Switch_VM(size_t vm)
+{
+	if (_no_vm != activeVM)
+	{
+		Save_State(vmContext[activeVM]);
+	}
+
+	activeVM = vm;
+
+	if (_no_vm != activeVM)
+	{
+		Restore_State(vmContext[activeVM]);
+	}
+}
+
+size_t GicVirtIC::Active_VM(void)
+{
+	return activeVM;
+}
+
+bool GicVirtIC::IRq_Pending(size_t vm)
 {
-	if (VICState::Started == vState)
+	bool pending = false;
+
+	if (vm < _max_vms)
 	{
-		delete vGicDist;
-		vGicDist = nullptr;
+		VIC_Context& ctx = vmContext[vm];
 
-		delete vGicRedist;
-		vGicRedist = nullptr;
+		for (size_t w = 0; (w < _nrPendingWords) && (false == pending); w++)
+		{
+			pending = (ctx.pending[w] > 0);
+		}
+
+		// State is Pending or Pending and Active, LRs of loaded partition are read from hardware
+		for (uint8_t i = 0; (i < nrLRs) && (false == pending); i++)
+		{
+			uint64_t lr = (vm == activeVM) ? Get_LR(i) : ctx.lr[i];
 
-		vState = VICState::Stopped;
+			pending = (lr >> _lr_state_shift) & 0x1;
+		}
 	}
+
+	return pending;
 }
 
 void GicVirtIC::Set_LR(uint8_t id, uint64_t val)
@@ -144,52 +308,252 @@ void GicVirtIC::Set_LR(uint8_t id, uint64_t val)
 	}
 }
 
-void GicVirtIC::Inject_IRq(uint32_t nr, vINTtype type)
+uint64_t GicVirtIC::Get_LR(uint8_t id)
 {
-	if (nr < _maxIRq)
+	uint64_t val = 0;
+
+	switch (id)
 	{
-		if (
-		    ((nr < _firstSPI) && vGicRedist->IRq_Enabled(nr)) ||		// nr == 0..31, what means it's SGI or PPI, so ask redistributor
-		    ((nr >= _firstSPI) && vGicDist->IRq_Enabled(nr))			// nr == 32.., what means it's SPI, so ask distributor
-		   )
+	case 0:
+		val = ReadICCReg(ICH_LR0_EL2);
+		break;
+	case 1:
+		val = ReadICCReg(ICH_LR1_EL2);
+		break;
+	case 2:
+		val = ReadICCReg(ICH_LR2_EL2);
+		break;
+	case 3:
+		val = ReadICCReg(ICH_LR3_EL2);
+		break;
+	case 4:
+		val = ReadICCReg(ICH_LR4_EL2);
+		break;
+	case 5:
+		val = ReadICCReg(ICH_LR5_EL2);
+		break;
+	case 6:
+		val = ReadICCReg(ICH_LR6_EL2);
+		break;
+	case 7:
+		val = ReadICCReg(ICH_LR7_EL2);
+		break;
+	case 8:
+		val = ReadICCReg(ICH_LR8_EL2);
+		break;
+	case 9:
+		val = ReadICCReg(ICH_LR9_EL2);
+		break;
+	case 10:
+		val = ReadICCReg(ICH_LR10_EL2);
+		break;
+	case 11:
+		val = ReadICCReg(ICH_LR11_EL2);
+		break;
+	case 12:
+		val = ReadICCReg(ICH_LR12_EL2);
+		break;
+	case 13:
+		val = ReadICCReg(ICH_LR13_EL2);
+		break;
+	case 14:
+		val = ReadICCReg(ICH_LR14_EL2);
+		break;
+	case 15:
+		val = ReadICCReg(ICH_LR15_EL2);
+		break;
+	default:
+		Fault("attempt to get out of range GIC LR");
+	}
+
+	return val;
+}
+
+uint8_t GicVirtIC::Find_LR(uint32_t nr)
+{
+	// LRs which are in use, i.e. not marked as empty
+	uint64_t usedLRs = ~ReadICCReg(ICH_ELRSR_EL2) & lrMask;
+	uint8_t found = nrLRs;
+
+	while ((usedLRs > 0) && (nrLRs == found))
+	{
+		uint8_t pos = FirstSetBit<uint16_t>(usedLRs);
+
+		// INT ID matches and state is not Invalid
+		if ((lrINT[pos] == nr) && (Get_LR(pos) >> _lr_state_shift))
 		{
-			uint64_t lrMask = ReadICCReg(ICH_ELRSR_EL2) & 0xf;
-			uint8_t pos = FirstSetBit<uint16_t>(lrMask);
+			found = pos;
+		}
+
+		ClearBit(usedLRs, pos);
+	}
+
+	return found;
+}
+
+bool GicVirtIC::Merge_LR(size_t vm, uint8_t pos, uint32_t nr, vINTtype type)
+{
+	uint64_t lr = Get_LR(pos);
+	uint64_t val = lr;
+	bool coalesced = true;
+
+	if (lr & _lr_hw)
+	{
+		// Physical INT is active until the guest deactivates it, so only software
+		// instance could get here and the guest takes it with the hardware one
+	}
+	else
+	if (vINTtype::Software == type)
+	{
+		// The guest has not yet taken the previous instance, so there is no need to
+		// notify it twice. This coalesces INT bursts from emulated devices.
+		coalesced = (lr & _lr_pending);
+		val |= _lr_pending;
+	}
+	else
+	if (0 == (lr & _lr_active))
+	{
+		// Pending software instance (e.g. PPI kept on partition switch) is linked to
+		// physical INT, so guest deactivation is forwarded to hardware
+		val = (lr & ~(_lr_pintid_mask | _lr_eoi)) | _lr_hw | ((uint64_t)nr << 32);
+	}
+	else
+	{
+		// HW LR can't be pending and active, so the new instance is kept as software
+		// one. Physical INT is deactivated on guest EOI, otherwise asserted level INT
+		// would be taken again while the guest handles the previous instance.
+		coalesced = (lr & _lr_pending);
+		val |= _lr_pending | _lr_eoi;
+		lrDeactivate |= (1UL << pos);
+	}
+
+	if (val != lr)
+	{
+		Set_LR(pos, val);
+		Trace(tevent::lr_inject, vm, nr, pos, (val & _lr_hw) != 0);
+	}
+
+	if (coalesced)
+	{
+		DDbg("vic: INT(%u) is already pending", nr);
+	}
+
+	return coalesced;
+}
+
+bool GicVirtIC::IRq_Enabled(size_t vm, uint32_t nr)
+{
+	bool ret = false;
+
+	if ((vm < _max_vms) && (VICState::Started == vmContext[vm].state))
+	{
+		ret = ((nr < _firstSPI) && vGicRedist[vm]->IRq_Enabled(nr)) ||		// nr == 0..31, what means it's SGI or PPI, so ask redistributor
+		      ((nr >= _firstSPI) && vGicDist[vm]->IRq_Enabled(nr));		// nr == 32.., what means it's SPI, so ask distributor
+	}
+
+	return ret;
+}
+
+bool GicVirtIC::Inject_IRq(size_t vm, uint32_t nr, vINTtype type)
+{
+	bool coalesced = false;
+
+	if (nr < _gicd_nr_lines)
+	{
+		bool enabled = IRq_Enabled(vm, nr);
+
+		// Deferred work injects INTs with IRqs unmasked, so guest INT taken in the middle
+		// of LR allocation or pending bitmap update would pick the same LR or bit
+		uint64_t flags = sync::Local_IRq_Save();
+
+		if (enabled && (vm != activeVM))
+		{
+			// Partition is not loaded, so keep INT until its time window starts
+			VIC_Context& ctx = vmContext[vm];
+			uint64_t mask = 1UL << (nr % 64);
+
+			coalesced = ctx.pending[nr / 64] & mask;
+			ctx.pending[nr / 64] |= mask;
+
+			if (vINTtype::Hardware == type)
+			{
+				ctx.hwPending[nr / 64] |= mask;
+			}
+		}
+		else
+		if (enabled)
+		{
+			// Two LRs with the same virtual INT ID are UNPREDICTABLE, so INT which is still
+			// in LR is merged with the new instance
+			uint8_t pos = Find_LR(nr);
 
 			if (pos < nrLRs)
 			{
-				uint64_t lr;
+				coalesced = Merge_LR(vm, pos, nr, type);
+			}
+			else
+			{
+				// LRs are reclaimed lazily: once the guest deactivates INT, the LR becomes
+				// invalid and it's reported as empty by ELRSR, so no maintenance is needed
+				pos = FirstSetBit<uint16_t>(ReadICCReg(ICH_ELRSR_EL2) & lrMask);
 
-				if (vINTtype::Hardware == type)
+				if (pos < nrLRs)
 				{
-					lr = (1UL << 62) | (1UL << 61) | (1UL << 60) | (0x80UL << 48) | ((uint64_t)nr << 32) | nr;	// State (Pending), Group (1), Priority (0x80)
+					uint64_t lr;
+
+					if (vINTtype::Hardware == type)
+					{
+						// Guest deactivation is forwarded to physical INT (HW bit), so no exit is needed
+						lr = (1UL << 62) | (1UL << 61) | (1UL << 60) | (0x80UL << 48) | ((uint64_t)nr << 32) | nr;	// State (Pending), HW, Group (1), Priority (0x80)
+					}
+					else // vINTtype::Software == type
+					{
+						lr = (1UL << 62) | (0UL << 61) | (1UL << 60) | (0x80UL << 48) | nr;				// State (Pending), Group (1), Priority (0x80)
+
+						if (trackEOI)
+						{
+							lr |= (1UL << 41);	// Request maintenance INT on EOI
+						}
+					}
+
+					lrINT[pos] = nr;
+
+					// Guest EOI time is visible only for LRs which request maintenance
+					if (trackEOI)
+					{
+						lrTime[pos] = Read_Counter();
+					}
+
+					Set_LR(pos, lr);
+					Trace(tevent::lr_inject, vm, nr, pos, vINTtype::Hardware == type);
 				}
-				else // vINTtype::Software == type
+				else
 				{
-					lr = (1UL << 62) | (0UL << 61) | (1UL << 60) | (0x80UL << 48) | (1UL << 41) | nr;		// State (Pending), Group (1), Priority (0x80)
+					Fault("gic: no free LRs, but queueing is not yet implemented");
 				}
-				Set_LR(pos, lr);
-			}
-			else
-			{
-				Fault("gic: no free LRs, but queueing is not yet implemented");
 			}
 		}
 		else
 		{
 			Info() << "warning: attempt to inject INT(" << nr << ") while it's disabled" << fmt::endl;
 		}
+
+		sync::Local_IRq_Restore(flags);
 	}
 	else
 	{
 		Info() << "warning: attempt to inject unsupported ESPI INT(" << nr << ")" << fmt::endl;
 	}
+
+	return coalesced;
 }
 
 void GicVirtIC::Process_ISR(void)
 {
 	uint64_t eisr = ReadICCReg(ICH_EISR_EL2);
 
+	Trace(tevent::maintenance, eisr);
+
 	while (eisr > 0)
 	{
 		uint8_t nr = FirstSetBit<uint16_t>(eisr);
@@ -197,15 +561,56 @@ void GicVirtIC::Process_ISR(void)
 		if (nr < nrLRs)
 		{
 			Set_LR(nr, 0);
+
+			// Physical INT was held active until the guest completes software instance
+			if (lrDeactivate & (1UL << nr))
+			{
+				CpuIface.Deactivate(lrINT[nr]);
+				ClearBit(lrDeactivate, nr);
+			}
+			else
+			{
+				Timings.Record(lrINT[nr], IRqTimingType::Guest, Read_Counter() - lrTime[nr]);
+			}
 		}
 
 		ClearBit(eisr, nr);
 	}
 }
 
+void GicVirtIC::Track_Guest_EOI(bool track)
+{
+	trackEOI = track;
+}
+
+uint64_t GicVirtIC::Get_Maintenance_Count(void)
+{
+	return maintenanceCount;
+}
+
+uint64_t GicVirtIC::Get_Maintenance_Rate(void)
+{
+	uint64_t rate = 0;
+
+	if (_no_vm != activeVM)
+	{
+		uint64_t elapsed = Read_Counter() - startTime;
+
+		if (elapsed > 0)
+		{
+			rate = (maintenanceCount * ReadArm64Reg(CNTFRQ_EL0)) / elapsed;
+		}
+	}
+
+	return rate;
+}
+
 void GicVirtIC::MaintenanceIRqHandler(uint32_t nr)
 {
-	thisVIC->Process_ISR();
+	GicVirtIC* vic = *thisVIC;
+
+	vic->maintenanceCount++;
+	vic->Process_ISR();
 }
 
 }; // namespace core
@@ -12,8 +12,11 @@
 
 #pragma once
 
+#include "../gic/config.hpp"
+
 #include <basetypes>
 #include <core/ivirtic>
+#include <system>
 
 namespace saturn {
 namespace core {
@@ -23,6 +26,7 @@ class CpuInterface;
 class GicDistributor;
 class VirtGicDistributor;
 class GicRedistributor;
+class IRqTimings;
 class VirtGicRedistributor;
 
 enum class VICState
@@ -32,19 +36,61 @@ enum class VICState
 	Failed
 };
 
+// Architecture limit for the number of LRs
+static const size_t _maxLRs = 16;
+
+static const size_t _nrPendingWords = _gicd_nr_lines / 64;
+
+// Virtual CPU interface state of the partition which is not loaded on the core
+struct VIC_Context
+{
+	VICState state;
+
+	uint64_t hcr;
+	uint64_t vmcr;
+	uint64_t ap0r0;
+	uint64_t ap1r0;
+	uint64_t lr[_maxLRs];
+	uint32_t lrINT[_maxLRs];
+
+	// INTs received while the partition was not loaded, they are injected on switch
+	uint64_t pending[_nrPendingWords];
+	uint64_t hwPending[_nrPendingWords];
+};
+
 class GicVirtIC
 {
 public:
-	GicVirtIC(CpuInterface&, GicDistributor&, GicRedistributor&);
+	GicVirtIC(CpuInterface&, GicDistributor&, GicRedistributor&, IRqTimings&);
 
 public:
-	void Start(void);
-	void Stop(void);
-	void Inject_IRq(uint32_t nr, vINTtype type);
+	void Start(size_t vm);
+	void Stop(size_t vm);
+	// Returns true if INT was merged with already pending one
+	bool Inject_IRq(size_t vm, uint32_t nr, vINTtype type);
 	void Process_ISR(void);
 
+public:
+	// Save LRs of loaded partition and restore the state of another one
+	void Switch_VM(size_t vm);
+	size_t Active_VM(void);
+	// Check LRs and INTs queued while the partition was not loaded
+	bool IRq_Pending(size_t vm);
+
+public:
+	void Track_Guest_EOI(bool);
+	uint64_t Get_Maintenance_Count(void);
+	uint64_t Get_Maintenance_Rate(void);
+
 private:
 	void Set_LR(uint8_t id, uint64_t val);
+	uint64_t Get_LR(uint8_t id);
+	uint8_t Find_LR(uint32_t nr);
+	bool Merge_LR(size_t vm, uint8_t pos, uint32_t nr, vINTtype type);
+	bool IRq_Enabled(size_t vm, uint32_t nr);
+
+	void Save_State(VIC_Context& ctx);
+	void Restore_State(VIC_Context& ctx);
 
 private:
 	// Maintenance INT handling routine
@@ -54,15 +100,31 @@ private:
 	CpuInterface& CpuIface;
 
 	GicDistributor& GicDist;
-	VirtGicDistributor* vGicDist;
+	VirtGicDistributor* vGicDist[_max_vms];
 
 	GicRedistributor& GicRedist;
-	VirtGicRedistributor* vGicRedist;
+	VirtGicRedistributor* vGicRedist[_max_vms];
 
-	VICState vState;
+	// Partition which owns the LRs at the moment
+	size_t activeVM;
+	VIC_Context (&vmContext)[];
+
+	IRqTimings& Timings;
+
+	// INT ID and write time of LRs which request EOI maintenance
+	uint32_t (&lrINT)[];
+	uint64_t (&lrTime)[];
 
 private:
 	uint8_t nrLRs;
+	uint64_t lrMask;	// Mask of implemented LRs
+	uint64_t lrDeactivate;	// LRs which deactivate physical INT on guest EOI
+
+	// Guest EOI of software INTs is reported via maintenance INT only on request
+	bool trackEOI;
+
+	uint64_t maintenanceCount;
+	uint64_t startTime;
 };
 
 }; // namespace core
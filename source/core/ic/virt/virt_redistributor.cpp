@@ -14,26 +14,29 @@
 
 #include <bitops>
 #include <bsp/platform>
-#include <core/iconsole>
+#include <core/idlog>
 #include <core/iic>
 #include <core/ivirtic>
 #include <core/ivmm>
 #include <core/ivmm>
+#include <system>
 
 namespace saturn {
 namespace core {
 
-static GicRedistRegs _VGicRedistState;
+// Each partition has own virtual redistributor. TBD: physical PPI enable state is
+// not switched with partition, so partitions sharing the core must agree on PPIs.
+static GicRedistRegs _VGicRedistState[_max_vms];
 
-VirtGicRedistributor::VirtGicRedistributor(GicRedistributor& redist)
+VirtGicRedistributor::VirtGicRedistributor(GicRedistributor& redist, size_t vm)
 	: gicRedist(redist)
-	, vRedistState(_VGicRedistState)
+	, vRedistState(_VGicRedistState[vm])
 {
 	mTrap = new MTrap(_gic_redist_addr, *this);
 
 	gicRedist.Load_State(vRedistState);
 
-	Info() << "vic: virtual redistributor created" << fmt::endl;
+	DInfo("vic: virtual redistributor created");
 }
 
 VirtGicRedistributor::~VirtGicRedistributor()
@@ -47,8 +50,7 @@ void VirtGicRedistributor::Read(uint64_t reg, void* data, AccessSize size)
 {
 	using Regs = GicRedistributor::Redist_Regs;
 
-	// DBG:
-	//Log() << "vredist: read from register offset 0x" << fmt::hex << reg << fmt::endl;
+	DDbg("vredist: read from register offset 0x%x", reg);
 
 	switch (reg)
 	{
@@ -71,8 +73,7 @@ void VirtGicRedistributor::Read(uint64_t reg, void* data, AccessSize size)
 			break;
 		}
 	default:
-		// DBG:
-		//Log() << "vredist: unsupported read from register offset 0x" << fmt::hex << reg << fmt::endl;
+		DDbg("vredist: unsupported read from register offset 0x%x", reg);
 		break;
 	}
 }
@@ -81,8 +82,7 @@ void VirtGicRedistributor::Write(uint64_t reg, void* data, AccessSize size)
 {
 	using Regs = GicRedistributor::Redist_Regs;
 
-	// DBG:
-	//Log() << "vredist: write value 0x" << fmt::hex << *static_cast<uint32_t*>(data) << " to register offset 0x" << reg << fmt::endl;
+	DDbg("vredist: write value 0x%x to register offset 0x%x", *static_cast<uint32_t*>(data), reg);
 
 	switch (reg)
 	{
@@ -112,8 +112,7 @@ void VirtGicRedistributor::Write(uint64_t reg, void* data, AccessSize size)
 					break;
 				}
 			default:
-				// DBG:
-				//Log() << "vredist: unsupported write to register offset 0x" << fmt::hex << reg << fmt::endl; 
+				DDbg("vredist: unsupported write to register offset 0x%x", reg);
 				break;
 			}
 		}
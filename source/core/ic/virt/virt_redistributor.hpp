@@ -22,7 +22,7 @@ namespace core {
 class VirtGicRedistributor : public IVirtIO
 {
 public:
-	VirtGicRedistributor(GicRedistributor&);
+	VirtGicRedistributor(GicRedistributor&, size_t);
 	~VirtGicRedistributor();
 
 public:
@@ -12,17 +12,21 @@
 
 #include "main.hpp"
 
+#include <arm64/registers>
 #include <bsp/platform>
 #include <core/iconsole>
+#include <percpu>
 #include <system>
 
-// Saturn stack definition
-saturn::uint64_t boot_stack[_stack_size] __align(_page_size);
+// Saturn stack definition, one per CPU
+saturn::uint64_t boot_stack[_max_cpus][_stack_size] __align(_page_size);
 
-// When switch to EL1 we don't need EL2 stack anymore except heap, which
-// could be allocated only on stack. So the following marker could be used
-// as SP to which we can reset the stack without damaging heap.
-saturn::uint64_t el2_stack_reset = 0;
+// Dedicated IRq stacks. Interrupt handlers run with INTs unmasked, so nested
+// frames are stacked here instead of the stack of interrupted context.
+saturn::uint64_t irq_stack[_max_cpus][_irq_stack_size] __align(16);
+
+// Current level of IRq nesting, 0 means no active IRq handler
+saturn::PerCpu<saturn::uint64_t> irq_nesting __percpu;
 
 namespace saturn {
 
@@ -41,7 +45,12 @@ namespace core {
 // External API:
 void Exceptions_Init();
 void MMU_Init();
+void MMU_Cpu_Init();
+void PerCpu_Init();
 void Start_VM_Manager();
+void SMP_Init();
+void SMP_Cpu_Online();
+void Idle_Loop();
 
 static void Main(void)
 {
@@ -51,9 +60,6 @@ static void Main(void)
 	Heap Main_Heap;
 	Saturn_Heap = &Main_Heap;
 
-	// Set stack marker. Below this marker the stack could be reset during switch to EL1
-	asm volatile("mov %0, sp" : "=r" (el2_stack_reset));
-
 	// TBD: check that all allocations are successful
 
 	// Let's create console as soon as possible to be able to collect output from MMU.
@@ -61,6 +67,9 @@ static void Main(void)
 	// Also let's keep heap initialization before, we could use it for buffering.
 	Saturn_Console = new Console();
 
+	// Per-CPU data must be available before any per-core state is touched
+	PerCpu_Init();
+
 	// Initialize hypervisor and guest MMUs
 	MMU_Init();
 
@@ -78,6 +87,12 @@ static void Main(void)
 	// Create interrupt controller object
 	Saturn_IC = new IC_Core();
 
+	// EL2 timer is shared by hypervisor services
+	Saturn_Timer = new Hyp_Timer();
+
+	// INT handlers defer the processing which doesn't need to be done immediately
+	Saturn_Work = new Work_Queue();
+
 	Info() << fmt::endl << "<core initialization complete>" << fmt::endl;
 
 	// Setup platform BSP
@@ -89,10 +104,37 @@ static void Main(void)
 	// Start VM manager
 	Saturn_VMM = new VM_Manager();
 
+	// Bring up secondary CPUs, they share all the core components
+	SMP_Init();
+
+	// Physical counter starts from reset, so it's the time spent by boot loader and Saturn
+	Info() << "boot: ready in " << (Read_Counter() * 1000000) / ReadArm64Reg(CNTFRQ_EL0) << " us" << fmt::endl;
+
 	// Core initialization is complete, switch control to applications
 	saturn::apps::Applications_Start();
 
-	for (;;);
+	// Console could be handed over to another CPU, so just wait for requests
+	Idle_Loop();
+}
+
+static void Secondary_Main(void)
+{
+	PerCpu_Init();
+
+	// Per-CPU part of core components initialization
+	Local_CPU = new CpuInfo();
+	Exceptions_Init();
+	MMU_Cpu_Init();
+	Saturn_IC->Cpu_Init();
+	Saturn_Timer->Cpu_Init();
+	Saturn_VMM->Cpu_Init();
+
+	SMP_Cpu_Online();
+
+	iIC().Local_IRq_Enable();
+
+	// Wait for the partition assigned to this CPU
+	Idle_Loop();
 }
 
 }; // namespace core
@@ -103,3 +145,8 @@ extern "C" void saturn_init()
 	// Let's switch to C++ world!
 	saturn::core::Main();
 }
+
+extern "C" void saturn_secondary_init()
+{
+	saturn::core::Secondary_Main();
+}
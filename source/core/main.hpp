@@ -15,9 +15,13 @@
 #include "console.hpp"
 #include "cpu.hpp"
 #include "heap.hpp"
+#include "hyp_timer.hpp"
 #include "ic/ic_core.hpp"
 #include "mm/mmu.hpp"
 #include "vmm/vm_manager.hpp"
+#include "work_queue.hpp"
+
+#include <percpu>
 
 namespace saturn {
 namespace core {
@@ -26,14 +30,18 @@ namespace core {
 static Heap* 			Saturn_Heap = nullptr;		// Heap object pointer to implement operators new/delete
 static Console* 		Saturn_Console = nullptr;	// Console pointer for trace and logging
 static IC_Core*			Saturn_IC = nullptr;		// Interrupt controller pointer for IRq management
-static CpuInfo*			Local_CPU = nullptr;		// CPU information pointer
+static PerCpu<CpuInfo*>		Local_CPU __percpu;		// CPU information pointer of each core
 static VM_Manager*		Saturn_VMM = nullptr;		// Virtual machine manager subsystem
+static Hyp_Timer*		Saturn_Timer = nullptr;		// Timer service of hypervisor components
+static Work_Queue*		Saturn_Work = nullptr;		// Deferred work of INT handlers
 
 // Access to global core components:
 //  - Console			(Log)
 //  - Interrupt Controller	(IC)
 //  - Memory Management		(MMU)
 //  - Heap			(Allocator)
+//  - Timer			(Deadlines)
+//  - Work queue		(Deferred work)
 
 IConsole& iConsole(void)
 {
@@ -57,7 +65,7 @@ IHeap& iHeap(void)
 
 ICPU& iCPU(void)
 {
-	return *Local_CPU;
+	return **Local_CPU;
 }
 
 IVirtualMachineManager& iVMM(void)
@@ -65,6 +73,16 @@ IVirtualMachineManager& iVMM(void)
 	return *Saturn_VMM;
 }
 
+ITimer& iTimer(void)
+{
+	return *Saturn_Timer;
+}
+
+IWorkQueue& iWork(void)
+{
+	return *Saturn_Work;
+}
+
 }; // namespace core
 }; // namespace saturn
 
@@ -26,7 +26,7 @@ static const size_t _l0_size = 1;		// Single entry which covers 512GB, should be
 // possibility to statically define number of translation tables based
 // on hardware configuration. Each table size is 4KB, so we could save
 // quite a lot RAM with fine-tunned configuration.
-static const size_t _l3_tables = 16;
+static const size_t _l3_tables = 32;
 
 }; // namespace core
 }; // namespace saturn
@@ -13,7 +13,8 @@
 #include "mmu.hpp"
 
 #include <arm64/registers>
-#include <core/iconsole>
+#include <core/idlog>
+#include <system>
 
 using namespace saturn::core;
 
@@ -26,43 +27,54 @@ tt_desc_t core_ptable_l3[_ptable_size]	__align(_page_size);
 namespace saturn {
 namespace core {
 
-// Guest PA-IPA data
-static tt_desc_t ipa_ptable_l1[_ptable_size]	__align(_page_size);
+// Guest PA-IPA data, each partition has own Stage-2 tables
+static tt_desc_t ipa_ptable_l1[_max_vms][_ptable_size]	__align(_page_size);
 
 static MemoryManagementUnit* 	Saturn_MMU = nullptr;		// MMU object pointer for hypervisor mapping
-static MemoryManagementUnit* 	Guest_MMU = nullptr;		// MMU object pointer for guest mapping
+static MemoryManagementUnit* 	Guest_MMU[_max_vms];		// MMU object pointers for guest mapping
 
-// External API:
-void Memory_Trap_Init(void);
-
-void MMU_Init(void)
+void MMU_Switch_VM(size_t vm)
 {
-	// Create Saturn MMU
-	Saturn_MMU = new MemoryManagementUnit(core_ptable_l1, MMapStage::Stage1);
+	// Each partition is tagged by own VMID, so TLB entries of different partitions
+	// could coexist and there is no need to flush TLB on switch. VMID 0 is skipped.
+	uint64_t vttbr = reinterpret_cast<uint64_t>(&ipa_ptable_l1[vm][0]) | (static_cast<uint64_t>(vm + 1) << 48);
+	WriteArm64Reg(VTTBR_EL2, vttbr);
+	asm volatile("isb" : : : "memory");
+}
 
+void MMU_Cpu_Init(void)
+{
 	// Initial value for VTCR_EL2:
 	//		  SH0_IS   | ORGN0_WBWA | IRGN0_WBWA |  SL0_L1   | T0SZ = 32 bits
 	uint64_t vtcr = (3U << 12) | (1U << 10) | (1U << 8)  | (1U << 6) | (64 - 32);
 	WriteArm64Reg(VTCR_EL2, vtcr);
-	
+
+	MMU_Switch_VM(0);
+}
+
+void MMU_Init(void)
+{
+	// Create Saturn MMU
+	Saturn_MMU = new MemoryManagementUnit(core_ptable_l1, MMapStage::Stage1);
+
 	// Set IPA page tables to 0 value
-	for (size_t i = 0; i < _ptable_size; i++)
+	for (size_t vm = 0; vm < _max_vms; vm++)
 	{
-		ipa_ptable_l1[i] = 0;
+		for (size_t i = 0; i < _ptable_size; i++)
+		{
+			ipa_ptable_l1[vm][i] = 0;
+		}
 	}
 
-	// Initial value for VTTBR_EL2
-	// TBD: set real VMID instead of '1'
-	uint64_t vttbr = reinterpret_cast<uint64_t>(&ipa_ptable_l1[0]) | (1UL << 48);
-	WriteArm64Reg(VTTBR_EL2, vttbr);
-
-	// Create guest IPA MMU
-	Guest_MMU = new MemoryManagementUnit(ipa_ptable_l1, MMapStage::Stage2);
+	MMU_Cpu_Init();
 
-	// Initialize guest memory traps
-	Memory_Trap_Init();
+	// Create guest IPA MMUs
+	for (size_t vm = 0; vm < _max_vms; vm++)
+	{
+		Guest_MMU[vm] = new MemoryManagementUnit(ipa_ptable_l1[vm], MMapStage::Stage2);
+	}
 
-	Info() << "memory management is initialized" << fmt::endl;
+	DInfo("memory management is initialized");
 }
 
 IMemoryManagementUnit& iMMU(void)
@@ -70,9 +82,9 @@ IMemoryManagementUnit& iMMU(void)
 	return *Saturn_MMU;
 }
 
-IMemoryManagementUnit& iMMU_VM(void)
+IMemoryManagementUnit& iMMU_VM(size_t vm)
 {
-	return *Guest_MMU;
+	return *Guest_MMU[vm];
 }
 
 }; // namespace core
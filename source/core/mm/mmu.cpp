@@ -13,6 +13,10 @@
 #include "mmu.hpp"
 #include "ttable.hpp"
 
+#include <arm64/registers>
+#include <core/idlog>
+#include <core/itrace>
+
 // TBD: rework it
 #include <fault>
 #include <mops>
@@ -83,12 +87,12 @@ lpae_block_t* MemoryManagementUnit::Map_L1_Block(uint64_t virt_addr, uint64_t ph
 		{
 			entry->valid = 1;
 			entry->type = LPAE_Type::Block;
-			entry->addr = phys_addr >> 30;
+			// Output address field starts from bit 21 for blocks of both levels
+			entry->addr = phys_addr >> _l2_addr_shift;
 
 			Fill_Mem_Attrs(entry, type);
 
-			Log() << "mm: PTable1[] -> 1GB block for address 0x"
-			      << fmt::hex << fmt::fill << virt_addr << fmt::endl;
+			DDbg("mm: PTable1[] -> 1GB block for address 0x%x", virt_addr);
 		}
 		else
 		{
@@ -127,8 +131,7 @@ lpae_block_t* MemoryManagementUnit::Map_L2_Block(uint64_t virt_addr, uint64_t ph
 
 			Fill_Mem_Attrs(entry, type);
 
-			Log() << "mm:   PTable2[] -> 2MB block for address 0x"
-			      << fmt::hex << fmt::fill << virt_addr << fmt::endl;
+			DDbg("mm:   PTable2[] -> 2MB block for address 0x%x", virt_addr);
 		}
 		else
 		{
@@ -170,8 +173,7 @@ lpae_page_t* MemoryManagementUnit::Map_L3_Page(uint64_t virt_addr, uint64_t phys
 
 				Fill_Mem_Attrs(reinterpret_cast<lpae_block_t*>(page), type);
 
-				Log() << "mm:     PTable3[] -> 4KB page for address 0x"
-				      << fmt::hex << fmt::fill << virt_addr << fmt::endl;
+				DDbg("mm:     PTable3[] -> 4KB page for address 0x%x", virt_addr);
 			}
 		}
 	}
@@ -198,8 +200,7 @@ lpae_table_t* MemoryManagementUnit::Map_L1_PTable(uint64_t virt_addr)
 				entry->type = LPAE_Type::Table;
 				entry->addr = ((uint64_t)ptable) >> 12;
 
-				Log() << "mm: PTable1[] -> PTable2[] for address 0x"
-				      << fmt::hex << fmt::fill << virt_addr << fmt::endl;
+				DDbg("mm: PTable1[] -> PTable2[] for address 0x%x", virt_addr);
 			}
 			else
 			{
@@ -243,8 +244,7 @@ lpae_table_t* MemoryManagementUnit::Map_L2_PTable(uint64_t virt_addr)
 				entry->type = LPAE_Type::Table;
 				entry->addr = ((uint64_t)ptable) >> 12;
 
-				Log() << "mm:   PTable2[] -> PTable3[] for address 0x"
-				      << fmt::hex << fmt::fill << virt_addr << fmt::endl;
+				DDbg("mm:   PTable2[] -> PTable3[] for address 0x%x", virt_addr);
 			}
 			else
 			{
@@ -266,12 +266,7 @@ lpae_table_t* MemoryManagementUnit::Map_L2_PTable(uint64_t virt_addr)
 
 void MemoryManagementUnit::TLB_Flush_All(void)
 {
-	asm volatile("\
-			dsb	nshst;		\
-			tlbi	vmalle1;	\
-			dsb	nsh;		\
-			isb;			\
-		     " : : : "memory");
+	TLB_Flush_EL1_IS();
 }
 
 void* MemoryManagementUnit::MemoryMap(Memory_Region& region)
@@ -287,6 +282,8 @@ void* MemoryManagementUnit::MemoryMap(uint64_t virt_addr, uint64_t phys_addr, si
 
 	void* ret = reinterpret_cast<void*>(start);
 
+	Trace(tevent::mmu_map, TStage, virt_addr, phys_addr, size);
+
 	do
 	{
 		if (((start & _l1_block_mask) == 0) &&	// virtual address is 1GB aligned
@@ -351,6 +348,8 @@ void MemoryManagementUnit::MemoryUnmap(uint64_t virt_addr, size_t size)
 	uint64_t start = virt_addr & _page_base;
 	uint64_t end = (virt_addr + size) & _page_base;
 
+	Trace(tevent::mmu_unmap, TStage, virt_addr, size);
+
 	do
 	{
 		size_t index = (start >> _l1_addr_shift) & _ptable_size_mask;
@@ -362,8 +361,7 @@ void MemoryManagementUnit::MemoryUnmap(uint64_t virt_addr, size_t size)
 			void* ptr = reinterpret_cast<void*>(entry);
 			MSet<uint64_t>(ptr, 1, 0);
 
-			Log() << "mm: PTable1[] -> free 1GB block for address 0x"
-			      << fmt::hex << fmt::fill << start << fmt::endl;
+			DDbg("mm: PTable1[] -> free 1GB block for address 0x%x", start);
 
 			start += BlockSize::L1_Block;
 		}
@@ -383,8 +381,7 @@ void MemoryManagementUnit::MemoryUnmap(uint64_t virt_addr, size_t size)
 				void* ptr = reinterpret_cast<void*>(entry);
 				MSet<uint64_t>(ptr, 1, 0);
 
-				Log() << "mm:   PTable2[] -> free 2MB block for address 0x"
-				      << fmt::hex << fmt::fill << start << fmt::endl;
+				DDbg("mm:   PTable2[] -> free 2MB block for address 0x%x", start);
 
 				start += BlockSize::L2_Block;
 			}
@@ -405,8 +402,7 @@ void MemoryManagementUnit::MemoryUnmap(uint64_t virt_addr, size_t size)
 					void* ptr = reinterpret_cast<void*>(page);
 					MSet<uint64_t>(ptr, 1, 0);
 
-					Log() << "mm:     PTable3[] -> free 4KB page for address 0x"
-					      << fmt::hex << fmt::fill << start << fmt::endl;
+					DDbg("mm:     PTable3[] -> free 4KB page for address 0x%x", start);
 
 					start += BlockSize::L3_Page;
 				}
@@ -473,7 +469,7 @@ void MemoryManagementUnit::Free_Empty_Tables(void)
 
 					if (empty_l3)
 					{
-						Log() << "mm:   PTable2[] -> free PTable3[]" << fmt::endl;
+						DDbg("mm:   PTable2[] -> free PTable3[]");
 						void* ptr = reinterpret_cast<void*>(entry_l2);
 						MSet<uint64_t>(ptr, 1, 0);
 						Free_Table(pt3);
@@ -487,7 +483,7 @@ void MemoryManagementUnit::Free_Empty_Tables(void)
 
 			if (empty_l2)
 			{
-				Log() << "mm: PTable1[] -> free PTable2[]" << fmt::endl;
+				DDbg("mm: PTable1[] -> free PTable2[]");
 				void* ptr = reinterpret_cast<void*>(entry_l1);
 				MSet<uint64_t>(ptr, 1, 0);
 				Free_Table(pt2);
@@ -14,45 +14,157 @@
 
 #include <arm64/registers>
 #include <core/iconsole>
-#include <lib/list>
+#include <core/idlog>
+#include <core/itrace>
+#include <core/ivmm>
+#include <lib/vector>
 #include <mtrap>
+#include <percpu>
+#include <sync/seqlock>
+#include <system>
+
+// Fast read table of the partition loaded on the core, accessed from vector.S
+saturn::PerCpu<saturn::core::Fast_Read*> fast_read_table __percpu;
 
 namespace saturn {
 namespace core {
 
 static const uint32_t _ec_abort_el1 = 0x24;			// Data Abort exception from lower Exception Level
-static lib::List<MTrap&> *mtraps_list = nullptr;
 
-void Memory_Trap_Init(void)
+static const size_t _maxTrapRegions = 8;
+
+// Copy of trap region bounds, so lookup doesn't follow MTrap pointers which could be
+// stale until the read is validated
+struct Trap_Region
 {
-	mtraps_list = new lib::List<MTrap&>;
-}
+	uint64_t	base;
+	uint64_t	size;
+	MTrap*		trap;
+};
+
+// Trap regions of each partition, registration never allocates
+static lib::StaticVector<Trap_Region, _maxTrapRegions> _trapRegions[_max_vms];
+
+// Trap regions are registered by VM start/stop and looked up by trap handlers on any
+// core. Lookups are lock-free, they just retry if the table was changed meanwhile.
+static sync::Seqlock mtraps_lock;
+
+// Fast read registers of each partition, empty entry has no value
+static Fast_Read _fastReads[_max_vms][_maxFastReads];
 
 void Register_Trap_Region(MTrap& mt)
 {
+	bool added = false;
+	uint64_t flags = mtraps_lock.Write_Lock();
+
 	// TBD: check if trap region to be added overlaps with
 	//      already existing one
-	mtraps_list->push_back(mt);
+	for (size_t vm = 0; vm < _max_vms; vm++)
+	{
+		if (mt.Owner(vm))
+		{
+			added = _trapRegions[vm].push_back({mt.GetBase(), mt.GetSize(), &mt});
+		}
+	}
+
+	mtraps_lock.Write_Unlock(flags);
+
+	if (false == added)
+	{
+		Error() << "trap: no space for region at 0x" << fmt::hex << mt.GetBase() << fmt::endl;
+	}
 }
 
 void Remove_Trap_Region(MTrap& mt)
 {
-	mtraps_list->remove(mt);
+	uint64_t flags = mtraps_lock.Write_Lock();
+
+	for (size_t vm = 0; vm < _max_vms; vm++)
+	{
+		if (mt.Owner(vm))
+		{
+			for (size_t i = 0; i < _trapRegions[vm].size(); i++)
+			{
+				if (&mt == _trapRegions[vm][i].trap)
+				{
+					_trapRegions[vm].erase(i);
+					break;
+				}
+			}
+
+			// Fast read entries are used only while the partition is loaded, so
+			// it's safe to drop them here
+			for (size_t i = 0; i < _maxFastReads; i++)
+			{
+				if (mt.InRange(_fastReads[vm][i].ipa, 4))
+				{
+					_fastReads[vm][i].value = nullptr;
+					_fastReads[vm][i].ipa = 0;
+				}
+			}
+		}
+	}
+
+	mtraps_lock.Write_Unlock(flags);
+}
+
+bool Register_Fast_Read(size_t vm, uint64_t addr, volatile uint32_t* value)
+{
+	bool ret = false;
+	uint64_t flags = mtraps_lock.Write_Lock();
+
+	for (size_t i = 0; (vm < _max_vms) && (i < _maxFastReads); i++)
+	{
+		if (nullptr == _fastReads[vm][i].value)
+		{
+			_fastReads[vm][i].ipa = addr;
+			_fastReads[vm][i].value = value;
+			ret = true;
+			break;
+		}
+	}
+
+	mtraps_lock.Write_Unlock(flags);
+
+	if (false == ret)
+	{
+		Error() << "trap: no space for fast read of 0x" << fmt::hex << addr << fmt::endl;
+	}
+
+	return ret;
+}
+
+void Fast_Read_Switch_VM(size_t vm)
+{
+	fast_read_table = (vm < _max_vms) ? _fastReads[vm] : nullptr;
 }
 
 static MTrap* Find_Trap_Node(uint64_t addr, uint64_t size)
 {
 	MTrap* node = nullptr;
+	size_t vm = Current_VM();
+	uint32_t seq;
+
+	if (vm >= _max_vms)
+	{
+		return nullptr;
+	}
 
-	for (auto it = mtraps_list->begin(); it != mtraps_list->end(); ++it)
+	do
 	{
-		MTrap& mt = *it;
-		if (mt.InRange(addr, size))
+		seq = mtraps_lock.Read_Begin();
+		node = nullptr;
+
+		for (const Trap_Region& region : _trapRegions[vm])
 		{
-			node = &mt;
-			break;
+			if ((addr >= region.base) && ((addr + size) <= (region.base + region.size)))
+			{
+				node = region.trap;
+				break;
+			}
 		}
 	}
+	while (mtraps_lock.Read_Retry(seq));
 
 	return node;
 }
@@ -111,6 +223,9 @@ bool Do_Memory_Trap(struct AArch64_Regs* Regs)
 			{
 				uint64_t offset = pa - mt->GetBase();
 
+				Trace(tevent::mmio_trap, pa, srt, 1U << sas, wnr);
+				DDbg("trap: %c at 0x%x, size %u", wnr ? 'w' : 'r', pa, 1U << sas);
+
 				if (wnr == 0)
 				{
 					mt->VDrv.Read(offset, reg, static_cast<AccessSize>(sas));
@@ -122,6 +237,10 @@ bool Do_Memory_Trap(struct AArch64_Regs* Regs)
 
 				ret = true;
 			}
+			else
+			{
+				DDbg("trap: no region for address 0x%x", pa);
+			}
 		}
 	}
 
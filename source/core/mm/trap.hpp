@@ -20,8 +20,20 @@
 namespace saturn {
 namespace core {
 
+// NOTE: this must be aligned with guest_fast_dabt in vector.S
+static const size_t _maxFastReads = 4;
+
+// Register of trap region which is read in exception fast path
+struct Fast_Read
+{
+	uint64_t		ipa;
+	volatile uint32_t*	value;
+};
+
 // External API:
 bool Do_Memory_Trap(struct AArch64_Regs* Regs);
+// Select fast read table of the partition loaded on the calling core
+void Fast_Read_Switch_VM(size_t vm);
 
 static inline uint64_t va_to_pa_el1(uint64_t va)
 {
@@ -0,0 +1,57 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#include <arm64/registers>
+#include <fault>
+#include <mops>
+#include <percpu>
+
+// Per-CPU data template boundaries (see linker script)
+extern char _percpu_start[];
+extern char _percpu_end[];
+
+namespace saturn {
+namespace core {
+
+// Per-CPU areas are aligned by cache line, so cores never share the lines of hot data
+static uint8_t _percpu_area[_max_cpus][_percpu_size] __align(_cache_line_size);
+static uint64_t _percpu_offset[_max_cpus];
+
+void PerCpu_Init(void)
+{
+	size_t cpu = ReadArm64Reg(MPIDR_EL1) & 0xff;
+	size_t size = _percpu_end - _percpu_start;
+
+	if (cpu >= _max_cpus)
+	{
+		Fault("percpu: CPU is out of supported range");
+	}
+
+	if (size > _percpu_size)
+	{
+		Fault("percpu: data does not fit the area, please increase the size");
+	}
+
+	// Each core starts from pristine copy of initial values
+	MCopy<uint8_t>(_percpu_start, &_percpu_area[cpu][0], size);
+
+	_percpu_offset[cpu] = reinterpret_cast<uint64_t>(&_percpu_area[cpu][0]) - reinterpret_cast<uint64_t>(_percpu_start);
+	WriteArm64Reg(TPIDR_EL2, _percpu_offset[cpu]);
+}
+
+uint64_t PerCpu_Offset(size_t cpu)
+{
+	return _percpu_offset[cpu];
+}
+
+}; // namespace core
+}; // namespace saturn
@@ -0,0 +1,209 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#include <arm64/registers>
+#include <core/iconsole>
+#include <core/icpu>
+#include <core/idlog>
+#include <core/ivmm>
+#include <core/iwork>
+#include <system>
+
+// Entry point for secondary CPUs (see head.S)
+extern "C" void secondary_entry();
+
+// Spin-table release addresses per CPU. Secondary CPUs which were started by boot
+// loader wait in head.S until respective value becomes non-zero. The table is polled
+// before primary CPU clears BSS, so it's kept in data segment. Should be global
+// without namespace to be visible in assembly boot code.
+saturn::uint64_t smp_release_addr[saturn::_max_cpus] __section(".data");
+
+namespace saturn {
+
+// Entry point to application layer
+namespace apps {
+	void Applications_Start();
+};
+
+namespace core {
+
+// PSCI function IDs and return codes (SMC64 calling convention)
+static const uint64_t _psci_cpu_on = 0xc4000003;
+static const int64_t _psci_success = 0;
+
+// Time to wait for secondary core to come online
+static const uint64_t _cpu_on_timeout_ms = 100;
+
+// Flags are accessed by different cores, so they must not be cached in registers
+static volatile bool cpu_online[_max_cpus];
+static volatile bool start_request[_max_cpus];
+
+// Function calls requested for idle cores
+using SMP_Func = void(*)(void*);
+static volatile SMP_Func call_func[_max_cpus];
+static void* volatile call_arg[_max_cpus];
+
+static int64_t PSCI_Cpu_On(uint64_t mpidr, uint64_t entry)
+{
+	register uint64_t x0 asm("x0") = _psci_cpu_on;
+	register uint64_t x1 asm("x1") = mpidr;
+	register uint64_t x2 asm("x2") = entry;
+	register uint64_t x3 asm("x3") = 0;
+
+	asm volatile("smc #0"
+		     : "+r" (x0)
+		     : "r" (x1), "r" (x2), "r" (x3)
+		     : "memory");
+
+	return static_cast<int64_t>(x0);
+}
+
+static void Spin_Table_Release(size_t cpu, uint64_t entry)
+{
+	smp_release_addr[cpu] = entry;
+
+	// Secondary cores poll the address with MMU and caches disabled, so push
+	// the value to the point of coherency and wake them up
+	asm volatile("dc civac, %0\n"
+		     "dsb sy\n"
+		     "sev\n"
+		     : : "r" (&smp_release_addr[cpu]) : "memory");
+}
+
+static bool Wait_Cpu_Online(size_t cpu)
+{
+	uint64_t timeout = Read_Counter() + (ReadArm64Reg(CNTFRQ_EL0) / 1000) * _cpu_on_timeout_ms;
+
+	while ((false == cpu_online[cpu]) && (Read_Counter() < timeout))
+	{
+		asm volatile("yield" : : : "memory");
+	}
+
+	return cpu_online[cpu];
+}
+
+void SMP_Init(void)
+{
+	uint64_t entry = reinterpret_cast<uint64_t>(&secondary_entry);
+	size_t nrOnline = 1;
+
+	cpu_online[iCPU().Id()] = true;
+
+	// Cores are started one by one, so there is no concurrent access to heap
+	// and other core components during per-CPU initialization
+	for (size_t cpu = 0; cpu < _max_cpus; cpu++)
+	{
+		if (cpu_online[cpu])
+		{
+			continue;
+		}
+
+		int64_t ret = PSCI_Cpu_On(cpu, entry);
+
+		if (_psci_success != ret)
+		{
+			// PSCI is not available or core is already running, so probably it was
+			// started by boot loader and waits in spin-table
+			DLog(log, "smp: PSCI CPU_ON(%u) returned %d, try spin-table", cpu, ret);
+			Spin_Table_Release(cpu, entry);
+		}
+
+		if (Wait_Cpu_Online(cpu))
+		{
+			nrOnline++;
+		}
+		else
+		{
+			Error() << "smp: CPU " << cpu << " failed to start" << fmt::endl;
+		}
+	}
+
+	DInfo("smp: %u CPU core(s) online", nrOnline);
+}
+
+void SMP_Cpu_Online(void)
+{
+	size_t cpu = iCPU().Id();
+
+	DInfo("smp: CPU %u is online", cpu);
+
+	asm volatile("dmb ish" : : : "memory");
+	cpu_online[cpu] = true;
+}
+
+bool SMP_Cpu_Is_Online(size_t cpu)
+{
+	return (cpu < _max_cpus) && cpu_online[cpu];
+}
+
+void SMP_Request_VM_Start(size_t cpu)
+{
+	if (cpu < _max_cpus)
+	{
+		asm volatile("dmb ish" : : : "memory");
+		start_request[cpu] = true;
+		asm volatile("dsb ish\n"
+			     "sev\n"
+			     : : : "memory");
+	}
+}
+
+bool SMP_Call(size_t cpu, void (*func)(void*), void* arg)
+{
+	bool ret = false;
+
+	// TBD: single caller is assumed, there is no queue of requests
+	if (SMP_Cpu_Is_Online(cpu) && (nullptr == call_func[cpu]))
+	{
+		call_arg[cpu] = arg;
+		asm volatile("dmb ish" : : : "memory");
+		call_func[cpu] = func;
+		asm volatile("dsb ish\n"
+			     "sev\n"
+			     : : : "memory");
+		ret = true;
+	}
+
+	return ret;
+}
+
+void Idle_Loop(void)
+{
+	size_t cpu = iCPU().Id();
+
+	// Wait for events: VM start request, function call or interrupts
+	while (true)
+	{
+		asm volatile("wfe" : : : "memory");
+
+		// Work which was queued outside of INT handler
+		iWork().Run_Work();
+
+		if (nullptr != call_func[cpu])
+		{
+			asm volatile("dmb ish" : : : "memory");
+			call_func[cpu](call_arg[cpu]);
+			call_func[cpu] = nullptr;
+		}
+
+		if (start_request[cpu])
+		{
+			start_request[cpu] = false;
+
+			// Never returns if VM is started successfully
+			iVMM().Start_VM();
+		}
+	}
+}
+
+}; // namespace core
+}; // namespace saturn
@@ -0,0 +1,145 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#include "trace.hpp"
+
+#include <arm64/atomic>
+#include <arm64/registers>
+#include <core/iconsole>
+#include <core/itrace>
+
+// Trace rings of all the cores. The symbol is global to be found in saturn.map, so
+// the rings could be decoded from raw memory dump as well.
+saturn::core::Trace_Ring trace_buffer[saturn::_max_cpus];
+
+volatile bool trace_enabled = false;
+
+namespace saturn {
+namespace core {
+
+// Tracepoints are hit before per-CPU areas are initialized, so rings are indexed by MPIDR
+static inline Trace_Ring& Local_Ring(size_t& cpu)
+{
+	cpu = (Read_Mpidr() & 0xff) % _max_cpus;
+
+	return trace_buffer[cpu];
+}
+
+void Trace_Record(tevent event, uint64_t a0, uint64_t a1, uint64_t a2, uint64_t a3)
+{
+	size_t cpu;
+	Trace_Ring& ring = Local_Ring(cpu);
+
+	uint64_t slot = Atomic_Fetch_Add(&ring.head, 1ULL);
+	Trace_Entry& entry = ring.entries[slot & (_traceRecords - 1)];
+
+	// Dump skips the record until it's complete. Release orders only the preceding
+	// stores, so the barrier keeps the payload below from passing the marker.
+	Store_Release(&entry.seq, 0U);
+	asm volatile("dmb ishst" : : : "memory");
+
+	entry.timestamp = Read_Counter();
+	entry.event = static_cast<uint16_t>(event);
+	entry.cpu = static_cast<uint8_t>(cpu);
+	entry.args[0] = a0;
+	entry.args[1] = a1;
+	entry.args[2] = a2;
+	entry.args[3] = a3;
+
+	asm volatile("dmb ishst" : : : "memory");
+	Store_Release(&entry.seq, static_cast<uint32_t>(slot + 1));
+}
+
+void Trace_Start(void)
+{
+	trace_enabled = false;
+
+	// Records of the previous trace are invalidated, otherwise the slot which is taken
+	// but not yet written could be dumped with the old content. Tracepoint which has
+	// passed the check on another core just puts its record to the new trace.
+	for (size_t cpu = 0; cpu < _max_cpus; cpu++)
+	{
+		for (size_t i = 0; i < _traceRecords; i++)
+		{
+			trace_buffer[cpu].entries[i].seq = 0;
+		}
+
+		Store_Release(&trace_buffer[cpu].head, 0ULL);
+	}
+
+	asm volatile("dmb ish" : : : "memory");
+	trace_enabled = true;
+
+	Info() << "trace: started" << fmt::endl;
+}
+
+void Trace_Stop(void)
+{
+	trace_enabled = false;
+
+	Info() << "trace: stopped" << fmt::endl;
+}
+
+void Trace_Dump(void)
+{
+	uint64_t total = 0;
+	uint64_t lost = 0;
+
+	// Decoder converts timestamps by the counter frequency
+	Raw() << "trace: begin freq " << fmt::dec << ReadArm64Reg(CNTFRQ_EL0) << fmt::endl;
+
+	for (size_t cpu = 0; cpu < _max_cpus; cpu++)
+	{
+		Trace_Ring& ring = trace_buffer[cpu];
+		uint64_t head = Load_Acquire(&ring.head);
+		uint64_t slot = (head > _traceRecords) ? head - _traceRecords : 0;
+
+		lost += slot;
+
+		for (; slot < head; slot++)
+		{
+			Trace_Entry& entry = ring.entries[slot & (_traceRecords - 1)];
+			uint32_t seq = static_cast<uint32_t>(slot + 1);
+
+			// Record is being written or was already overwritten by the next round
+			if (Load_Acquire(&entry.seq) != seq)
+			{
+				lost++;
+				continue;
+			}
+
+			uint64_t timestamp = entry.timestamp;
+			uint16_t event = entry.event;
+			uint64_t args[4] = {entry.args[0], entry.args[1], entry.args[2], entry.args[3]};
+
+			// Writer could start the next round while the payload is copied
+			asm volatile("dmb ishld" : : : "memory");
+			if (entry.seq != seq)
+			{
+				lost++;
+				continue;
+			}
+
+			Raw() << "trace: " << fmt::dec << cpu << " " << static_cast<uint32_t>(event)
+			      << fmt::hex << " 0x" << timestamp
+			      << " 0x" << args[0] << " 0x" << args[1]
+			      << " 0x" << args[2] << " 0x" << args[3] << fmt::dec << fmt::endl;
+
+			total++;
+		}
+	}
+
+	Raw() << "trace: end " << total << " records, " << lost << " lost" << fmt::endl;
+}
+
+}; // namespace core
+}; // namespace saturn
@@ -0,0 +1,46 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include <basetypes>
+#include <system>
+
+namespace saturn {
+namespace core {
+
+// Number of records in ring of each core, must be power of 2
+static const size_t _traceRecords = 512;
+
+// Layout of the record is parsed by scripts/trace_decode.py from raw memory dump,
+// so it must be kept in sync with the tool
+struct Trace_Entry
+{
+	uint64_t	timestamp;	// CNTPCT_EL0
+	uint16_t	event;		// tevent
+	uint8_t		cpu;
+	uint8_t		reserved;
+	volatile uint32_t seq;		// Slot number + 1, 0 while the record is written
+	uint64_t	args[4];
+};
+
+// Writer reserves the slot by atomic increment of the head, so nested INT handlers
+// on the same core never share the record. Old records are overwritten.
+struct Trace_Ring
+{
+	volatile uint64_t head;
+	uint64_t	reserved[7];	// Keep the records cache line aligned
+	Trace_Entry	entries[_traceRecords];
+} __align(64);
+
+}; // namespace core
+}; // namespace saturn
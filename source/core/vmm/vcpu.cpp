@@ -0,0 +1,94 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+
+#include "vcpu.hpp"
+
+#include <mops>
+#include <percpu>
+
+extern saturn::PerCpu<saturn::uint64_t> irq_nesting;
+
+extern "C" {
+	extern saturn::uint64_t Guest_Enter(struct saturn::AArch64_Regs*, saturn::core::Host_Context*);
+	extern __noreturn void Guest_Exit(saturn::core::Host_Context*, saturn::uint64_t);
+}
+
+namespace saturn {
+namespace core {
+
+VCpu::VCpu(VM_Context& ctx)
+	: context(ctx)
+	, host()
+	, started(false)
+{}
+
+VCpu::~VCpu()
+{}
+
+void VCpu::Reset(uint64_t entry)
+{
+	MSet<uint8_t>(&context.regs, sizeof(context.regs), 0);
+
+	context.regs.cpsr_el2 = 0x3c5;
+	context.regs.pc_el2 = entry;
+	context.regs.sp_el1 = entry;	// Some temporary location in VM address space
+
+	EL1_Context_Reset(context.el1);
+
+	started = true;
+}
+
+void VCpu::Stop(void)
+{
+	started = false;
+}
+
+bool VCpu::Started(void)
+{
+	return started;
+}
+
+struct AArch64_Regs& VCpu::Regs(void)
+{
+	return context.regs;
+}
+
+void VCpu::Load(void)
+{
+	EL1_Context_Restore(context.el1);
+}
+
+void VCpu::Save(void)
+{
+	EL1_Context_Save(context.el1);
+}
+
+vcpu_exit VCpu::Run(void)
+{
+	// Returns when Exit() is called from exception handler
+	return static_cast<vcpu_exit>(Guest_Enter(&context.regs, &host));
+}
+
+void VCpu::Exit(struct AArch64_Regs& frame, vcpu_exit reason)
+{
+	MCopy<uint64_t>(&frame, &context.regs, sizeof(frame) / sizeof(uint64_t));
+
+	// Guest exit abandons the IRq stack, so INT nesting is reset only when the exit
+	// really happens: failed exit returns to the handler with the counter intact
+	irq_nesting = 0;
+
+	Guest_Exit(&host, static_cast<uint64_t>(reason));
+}
+
+}; // namespace core
+}; // namespace saturn
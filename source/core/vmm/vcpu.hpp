@@ -0,0 +1,76 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+
+#pragma once
+
+#include "vm_context.hpp"
+
+#include <core/ivmm>
+#include <system>
+
+namespace saturn {
+namespace core {
+
+// NOTE: this must be aligned with Guest_Enter/Guest_Exit in vector.S
+struct Host_Context
+{
+	// Callee-saved registers of the hypervisor
+	uint64_t	x19;
+	uint64_t	x20;
+	uint64_t	x21;
+	uint64_t	x22;
+	uint64_t	x23;
+	uint64_t	x24;
+	uint64_t	x25;
+	uint64_t	x26;
+	uint64_t	x27;
+	uint64_t	x28;
+	uint64_t	fp;
+	uint64_t	lr;
+	uint64_t	sp;
+};
+
+// Virtual CPU of the partition. Run() enters the guest and returns to the VM
+// manager with the exit reason, so the hypervisor stack is kept intact while
+// the guest is running.
+class VCpu
+{
+public:
+	VCpu(VM_Context& ctx);
+	~VCpu();
+
+public:
+	// Set the guest to the state after reset
+	void Reset(uint64_t entry);
+	void Stop(void);
+	bool Started(void);
+	struct AArch64_Regs& Regs(void);
+
+public:
+	// Move EL1 state between the context and the calling core
+	void Load(void);
+	void Save(void);
+
+public:
+	vcpu_exit Run(void);
+	// Save the guest exception frame and return from Run()
+	__noreturn void Exit(struct AArch64_Regs& frame, vcpu_exit reason);
+
+private:
+	VM_Context&		context;
+	Host_Context		host;
+	bool			started;
+};
+
+}; // namespace core
+}; // namespace saturn
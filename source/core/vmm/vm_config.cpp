@@ -14,30 +14,30 @@
 
 #include <core/iconsole>
 #include <core/iic>
-#include <mops>
+#include <core/ivirtic>
+#include <system>
 
 namespace saturn {
 namespace core {
 
-// TBD: should be global const comming from BSP
-static const size_t _nrINTs = 256;
-static const size_t _nrMMaps = 16;
-
 // Let's use data segment for configuration to avoid additional load on heap
-static uint8_t _hwINTMask[_nrINTs / 8 + 1];
-static Memory_Region _memRegions[_nrMMaps];
-
-VM_Configuration::VM_Configuration()
-	: hwINTMask(_hwINTMask)
-	, memRegions(_memRegions)
-	, nrRegions(0)
+static VM_INT_Map _hwINTs[_max_vms];
+static VM_Region_Table _memRegions[_max_vms];
+
+VM_Configuration::VM_Configuration(size_t id)
+	: vmID(id)
+	, cfgLock()
+	, hwINTs(_hwINTs[id])
+	, memRegions(_memRegions[id])
 	, osEntry(0)
+	, vmCPU(0)
+	, idleTrapSet(false)
+	, trapWFI(false)
+	, trapWFE(false)
 {
-	// Clean up assigned interrupts mask
-	for (int i = 0; i < (_nrINTs / 8); i++)
-	{
-		hwINTMask[i] = 0;
-	}
+	// Clean up the configuration of previous instance
+	hwINTs.reset();
+	memRegions.clear();
 }
 
 VM_Configuration::~VM_Configuration()
@@ -47,7 +47,9 @@ void VM_Configuration::VM_Assign_Interrupt(size_t nr)
 {
 	if (nr < _nrINTs)
 	{
-		hwINTMask[nr / 8] |= (1 << (nr % 8));
+		uint64_t flags = cfgLock.Write_Lock();
+		hwINTs.set(nr);
+		cfgLock.Write_Unlock(flags);
 	}
 }
 
@@ -57,55 +59,88 @@ bool VM_Configuration::VM_Own_Interrupt(size_t nr)
 
 	if (nr < _nrINTs)
 	{
-		ret = hwINTMask[nr / 8] & (1 << (nr % 8));
+		uint32_t seq;
+
+		do
+		{
+			seq = cfgLock.Read_Begin();
+			ret = hwINTs.test(nr);
+		}
+		while (cfgLock.Read_Retry(seq));
 	}
 
 	return ret;
 }
 
-void VM_Configuration::VM_Assign_Memory_Region(Memory_Region region)
+VM_INT_Map VM_Configuration::VM_Interrupts(void)
 {
-	if (nrRegions < _nrMMaps)
+	VM_INT_Map ints;
+	uint32_t seq;
+
+	do
 	{
-		MCopy<uint8_t>(&region, &memRegions[nrRegions], sizeof(Memory_Region));
-		nrRegions++;
+		seq = cfgLock.Read_Begin();
+		ints = hwINTs;
 	}
-	else
+	while (cfgLock.Read_Retry(seq));
+
+	return ints;
+}
+
+void VM_Configuration::VM_Assign_Memory_Region(Memory_Region region)
+{
+	uint64_t flags = cfgLock.Write_Lock();
+	bool added = memRegions.push_back(region);
+	cfgLock.Write_Unlock(flags);
+
+	if (false == added)
 	{
-		Error() << "VM: configuration exceeds memory regions table, please increase the size" << fmt::endl;
+		Error() << "VM" << vmID << ": configuration exceeds memory regions table, please increase the size" << fmt::endl;
 	}
 }
 
+// Stage-2 TLB maintenance affects the current VMID only, so resources are
+// allocated and freed while the partition is loaded on the calling core
 void VM_Configuration::VM_Allocate_Resources(void)
 {
+	VM_INT_Map ints = VM_Interrupts();
+
 	// Map IPA memory
-	for (size_t i = 0; i < nrRegions; i++)
+	for (auto& region : memRegions)
 	{
-		iMMU_VM().MemoryMap(memRegions[i]);
+		iMMU_VM(vmID).MemoryMap(region);
+	}
+
+	// Route assigned physical interrupts to the guest
+	for (size_t nr = ints.find_first(); nr < _nrINTs; nr = ints.find_next(nr + 1))
+	{
+		iVirtIC().Assign_VM_IRq(nr, vmID);
 	}
 }
 
 void VM_Configuration::VM_Free_Resources(void)
 {
+	VM_INT_Map ints = VM_Interrupts();
+
 	// Free IPA memory
-	for (size_t i = 0; i < nrRegions; i++)
+	for (auto& region : memRegions)
 	{
-		iMMU_VM().MemoryUnmap(memRegions[i]);
+		iMMU_VM(vmID).MemoryUnmap(region);
 	}
 
-	// Disable assigned physical interrupts
-	for (size_t i = 0; i < _nrINTs; i++)
+	// Disable assigned physical interrupts, only the words with set bits are visited
+	for (size_t nr = ints.find_first(); nr < _nrINTs; nr = ints.find_next(nr + 1))
 	{
-		if (VM_Own_Interrupt(i))
-		{
-			iIC().IRq_Disable(i);
-		}
+		iIC().IRq_Disable(nr);
+		iVirtIC().Release_VM_IRq(nr);
 	}
 }
 
 void VM_Configuration::VM_Set_Entry_Address(uint64_t addr)
 {
+	uint64_t flags = cfgLock.Write_Lock();
 	osEntry = addr;
+	cfgLock.Write_Unlock(flags);
 }
 
 uint64_t VM_Configuration::VM_Get_Entry_Address(void)
@@ -113,5 +148,50 @@ uint64_t VM_Configuration::VM_Get_Entry_Address(void)
 	return osEntry;
 }
 
+void VM_Configuration::VM_Set_CPU(size_t cpu)
+{
+	if (cpu < _max_cpus)
+	{
+		uint64_t flags = cfgLock.Write_Lock();
+		vmCPU = cpu;
+		cfgLock.Write_Unlock(flags);
+	}
+	else
+	{
+		Error() << "VM" << vmID << ": configuration requests CPU " << cpu << " which is out of supported range" << fmt::endl;
+	}
+}
+
+size_t VM_Configuration::VM_Get_CPU(void)
+{
+	return vmCPU;
+}
+
+void VM_Configuration::VM_Set_Idle_Trap(bool wfi, bool wfe)
+{
+	uint64_t flags = cfgLock.Write_Lock();
+	trapWFI = wfi;
+	trapWFE = wfe;
+	idleTrapSet = true;
+	cfgLock.Write_Unlock(flags);
+}
+
+bool VM_Configuration::VM_Get_Idle_Trap(bool& wfi, bool& wfe)
+{
+	bool ret;
+	uint32_t seq;
+
+	do
+	{
+		seq = cfgLock.Read_Begin();
+		wfi = trapWFI;
+		wfe = trapWFE;
+		ret = idleTrapSet;
+	}
+	while (cfgLock.Read_Retry(seq));
+
+	return ret;
+}
+
 }; // namespace core
 }; // namespace saturn
@@ -13,13 +13,23 @@
 #include <basetypes>
 #include <core/immu>
 #include <core/ivmm>
+#include <lib/bitmap>
+#include <lib/vector>
+#include <sync/seqlock>
 
 namespace saturn {
 namespace core {
 
+// TBD: should be global const comming from BSP
+static const size_t _nrINTs = 256;
+static const size_t _nrMMaps = 16;
+
+using VM_INT_Map = lib::Bitmap<_nrINTs>;
+using VM_Region_Table = lib::StaticVector<Memory_Region, _nrMMaps>;
+
 class VM_Configuration : public IVirtualMachineConfig {
 public:
-	VM_Configuration();
+	VM_Configuration(size_t id);
 	~VM_Configuration();
 
 // Configuration interface:
@@ -27,7 +37,8 @@ public:
 	void VM_Assign_Interrupt(size_t nr);
 	void VM_Assign_Memory_Region(Memory_Region region);
 	void VM_Set_Entry_Address(uint64_t addr);
-
+	void VM_Set_CPU(size_t cpu);
+	void VM_Set_Idle_Trap(bool wfi, bool wfe);
 
 // VM resources management:
 public:
@@ -35,17 +46,37 @@ public:
 	void VM_Free_Resources(void);
 	bool VM_Own_Interrupt(size_t nr);
 	uint64_t VM_Get_Entry_Address(void);
+	size_t VM_Get_CPU(void);
+	// Returns false if trapping is not configured explicitly
+	bool VM_Get_Idle_Trap(bool& wfi, bool& wfe);
+
+private:
+	// Consistent copy of assigned interrupts
+	VM_INT_Map VM_Interrupts(void);
 
 private:
+	// Partition ID, it's also index in the configuration tables
+	size_t vmID;
+
+	// Configuration is read from trap handlers on any core, but rarely modified
+	sync::Seqlock cfgLock;
+
 	// INT configuration
-	uint8_t	(&hwINTMask)[];
+	VM_INT_Map& hwINTs;
 
 	// MMU configuration
-	Memory_Region (&memRegions)[];
-	size_t nrRegions;
+	VM_Region_Table& memRegions;
 
 	// Entry address for guest operating system
 	uint64_t osEntry;
+
+	// CPU core which runs the guest
+	size_t vmCPU;
+
+	// Trapping of guest WFI and WFE instructions
+	bool idleTrapSet;
+	bool trapWFI;
+	bool trapWFE;
 };
 
 }; // namespace core
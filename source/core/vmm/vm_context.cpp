@@ -0,0 +1,105 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#include "vm_context.hpp"
+
+#include <mops>
+
+namespace saturn {
+namespace core {
+
+// CPTR_EL2: bits 13:12 and 9:0 are RES1, TFP (bit 10) traps FP/SIMD access
+static const uint64_t _cptr_res1 = 0x33ff;
+static const uint64_t _cptr_tfp = (1 << 10);
+
+void EL1_Context_Reset(EL1_Context& ctx)
+{
+	MSet<uint8_t>(&ctx, sizeof(ctx), 0);
+
+	// Default value collected after cold reset
+	ctx.sctlr = 0xc50838;
+}
+
+void EL1_Context_Save(EL1_Context& ctx)
+{
+	// Stop the virtual timer first, so it doesn't fire for the next partition
+	ctx.cntv_ctl = ReadArm64Reg(cntv_ctl_el0);
+	WriteArm64Reg(cntv_ctl_el0, 0);
+	ctx.cntv_cval = ReadArm64Reg(cntv_cval_el0);
+	ctx.cntkctl = ReadArm64Reg(cntkctl_el1);
+
+	ctx.sctlr = ReadArm64Reg(sctlr_el1);
+	ctx.cpacr = ReadArm64Reg(cpacr_el1);
+	ctx.ttbr0 = ReadArm64Reg(ttbr0_el1);
+	ctx.ttbr1 = ReadArm64Reg(ttbr1_el1);
+	ctx.tcr = ReadArm64Reg(tcr_el1);
+	ctx.mair = ReadArm64Reg(mair_el1);
+	ctx.amair = ReadArm64Reg(amair_el1);
+	ctx.vbar = ReadArm64Reg(vbar_el1);
+	ctx.contextidr = ReadArm64Reg(contextidr_el1);
+	ctx.esr = ReadArm64Reg(esr_el1);
+	ctx.far = ReadArm64Reg(far_el1);
+	ctx.afsr0 = ReadArm64Reg(afsr0_el1);
+	ctx.afsr1 = ReadArm64Reg(afsr1_el1);
+	ctx.par = ReadArm64Reg(par_el1);
+	ctx.csselr = ReadArm64Reg(csselr_el1);
+
+	ctx.tpidr_el0 = ReadArm64Reg(tpidr_el0);
+	ctx.tpidrro_el0 = ReadArm64Reg(tpidrro_el0);
+	ctx.tpidr_el1 = ReadArm64Reg(tpidr_el1);
+	ctx.sp_el0 = ReadArm64Reg(sp_el0);
+}
+
+void EL1_Context_Restore(const EL1_Context& ctx)
+{
+	WriteArm64Reg(sctlr_el1, ctx.sctlr);
+	WriteArm64Reg(cpacr_el1, ctx.cpacr);
+	WriteArm64Reg(ttbr0_el1, ctx.ttbr0);
+	WriteArm64Reg(ttbr1_el1, ctx.ttbr1);
+	WriteArm64Reg(tcr_el1, ctx.tcr);
+	WriteArm64Reg(mair_el1, ctx.mair);
+	WriteArm64Reg(amair_el1, ctx.amair);
+	WriteArm64Reg(vbar_el1, ctx.vbar);
+	WriteArm64Reg(contextidr_el1, ctx.contextidr);
+	WriteArm64Reg(esr_el1, ctx.esr);
+	WriteArm64Reg(far_el1, ctx.far);
+	WriteArm64Reg(afsr0_el1, ctx.afsr0);
+	WriteArm64Reg(afsr1_el1, ctx.afsr1);
+	WriteArm64Reg(par_el1, ctx.par);
+	WriteArm64Reg(csselr_el1, ctx.csselr);
+
+	WriteArm64Reg(tpidr_el0, ctx.tpidr_el0);
+	WriteArm64Reg(tpidrro_el0, ctx.tpidrro_el0);
+	WriteArm64Reg(tpidr_el1, ctx.tpidr_el1);
+	WriteArm64Reg(sp_el0, ctx.sp_el0);
+
+	// Timer is enabled last, when the rest of partition state is in place
+	WriteArm64Reg(cntkctl_el1, ctx.cntkctl);
+	WriteArm64Reg(cntv_cval_el0, ctx.cntv_cval);
+	WriteArm64Reg(cntv_ctl_el0, ctx.cntv_ctl);
+
+	asm volatile("isb" : : : "memory");
+}
+
+void FP_Context_Reset(FP_Context& ctx)
+{
+	MSet<uint64_t>(&ctx, sizeof(ctx) / sizeof(uint64_t), 0);
+}
+
+void FP_Trap(bool enable)
+{
+	WriteArm64Reg(CPTR_EL2, enable ? (_cptr_res1 | _cptr_tfp) : _cptr_res1);
+	asm volatile("isb" : : : "memory");
+}
+
+}; // namespace core
+}; // namespace saturn
@@ -0,0 +1,84 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include <arm64/registers>
+#include <basetypes>
+#include <system>
+
+namespace saturn {
+namespace core {
+
+// EL1&0 system registers of the partition. They are kept in hardware while
+// the partition is loaded on the core and saved only on partition switch.
+struct EL1_Context
+{
+	// Memory management and exceptions
+	uint64_t	sctlr;
+	uint64_t	cpacr;
+	uint64_t	ttbr0;
+	uint64_t	ttbr1;
+	uint64_t	tcr;
+	uint64_t	mair;
+	uint64_t	amair;
+	uint64_t	vbar;
+	uint64_t	contextidr;
+	uint64_t	esr;
+	uint64_t	far;
+	uint64_t	afsr0;
+	uint64_t	afsr1;
+	uint64_t	par;
+	uint64_t	csselr;
+
+	// Thread ID registers and EL0 stack
+	uint64_t	tpidr_el0;
+	uint64_t	tpidrro_el0;
+	uint64_t	tpidr_el1;
+	uint64_t	sp_el0;
+
+	// Virtual timer
+	uint64_t	cntkctl;
+	uint64_t	cntv_ctl;
+	uint64_t	cntv_cval;
+};
+
+// NOTE: this must be aligned with FP_Save/FP_Restore in fpsimd.S
+struct FP_Context
+{
+	uint64_t	q[64];		// Q0..Q31, 128 bits each
+	uint64_t	fpsr;
+	uint64_t	fpcr;
+} __align(16);
+
+// Complete state of the partition which is not running on the core
+struct VM_Context
+{
+	// Exception frame, it's loaded to the stack on partition switch
+	struct AArch64_Regs	regs;
+	EL1_Context		el1;
+	// Saved only when another partition on the core uses FP/SIMD
+	FP_Context		fp;
+};
+
+// Set EL1 registers to the state after cold reset
+void EL1_Context_Reset(EL1_Context& ctx);
+void EL1_Context_Save(EL1_Context& ctx);
+void EL1_Context_Restore(const EL1_Context& ctx);
+
+// Lazy FP/SIMD switching, the register file is owned by single partition on the core
+void FP_Context_Reset(FP_Context& ctx);
+// Trap FP/SIMD access if the partition doesn't own the register file
+void FP_Trap(bool enable);
+
+}; // namespace core
+}; // namespace saturn
@@ -12,41 +12,77 @@
 
 #include "vm_manager.hpp"
 
+#include <arm64/atomic>
 #include <arm64/registers>
 #include <bsp/ibsp>
 #include <core/iconsole>
+#include <core/icpu>
+#include <core/idlog>
 #include <core/iic>
 #include <core/ivirtic>
 #include <core/immu>
-#include <mops>
+#include <core/itrace>
+#include <percpu>
 
 extern "C" {
-	extern void Switch_EL12(struct saturn::AArch64_Regs*);
+	extern void FP_Save(saturn::core::FP_Context*);
+	extern void FP_Restore(saturn::core::FP_Context*);
 }
 
-extern saturn::uint64_t el2_stack_reset;
-
 namespace saturn {
+namespace core {
 
-namespace apps {
-	void Applications_Start();
-};
+// External API:
+bool SMP_Cpu_Is_Online(size_t cpu);
+void SMP_Request_VM_Start(size_t cpu);
+void MMU_Switch_VM(size_t vm);
+void Fast_Read_Switch_VM(size_t vm);
 
-namespace core {
+// Trap guest WFI and WFE instructions
+static const uint64_t _hcr_twi = (1UL << 13);
+static const uint64_t _hcr_twe = (1UL << 14);
+
+// Partition which is loaded on the core
+static PerCpu<size_t> currentVM __percpu = _no_vm;
+
+// Partition which owns FP/SIMD registers of the core
+static PerCpu<size_t> fpOwner __percpu = _no_vm;
+
+// Saved state of partitions which are not running at the moment
+static VM_Context _vmContext[_max_vms];
+
+size_t Current_VM(void)
+{
+	return *currentVM;
+}
 
 VM_Manager::VM_Manager()
 	: vmState(vm_state::stopped)
-	, vmConfig(nullptr)
+	, nrVMs(0)
+	, nrActiveCpus(0)
+	, nrRunningCpus(0)
+	, vmScheduler(nullptr)
+	, vmContext(_vmContext)
+	, vmConfig()
+	, vCpu()
+{
+	Cpu_Init();
+
+	DInfo("VM manager started");
+
+	// Fill the configuration for Saturn virtual machines
+	Load_Config();
+}
+
+void VM_Manager::Cpu_Init(void)
 {
 	// Enable Stage-2 translation for EL1&0 and use AArch64 mode
 	uint64_t hcr = ReadArm64Reg(HCR_EL2);
 	hcr |= (1 << 31) | (1 << 0);	// RW,bit[31] | VM,bit[0]
 	WriteArm64Reg(HCR_EL2, hcr);
 
-	Info() << "VM manager started" << fmt::endl;
-
-	// Fill the configuration for Saturn virtual machines
-	Load_Config();
+	// FP/SIMD registers are not owned until the first guest access
+	FP_Trap(true);
 }
 
 VM_Manager::~VM_Manager()
@@ -54,76 +90,410 @@ VM_Manager::~VM_Manager()
 
 void VM_Manager::Load_Config(void)
 {
-	// Create new VM configuration
-	vmConfig = new VM_Configuration;
-	
-	Info() << "vmm: load VM configuration" << fmt::endl;
+	nrVMs = bsp::iBSP().Get_Nr_VMs();
+
+	if (nrVMs > _max_vms)
+	{
+		Error() << "vmm: " << nrVMs << " partitions are configured, but only " << _max_vms << " are supported" << fmt::endl;
+		nrVMs = _max_vms;
+	}
+
+	DInfo("vmm: load configuration of %u VM(s)", nrVMs);
 
 	// Load the configuration from BSP
-	bsp::iBSP().Load_VM_Configuration(*vmConfig);
+	for (size_t vm = 0; vm < nrVMs; vm++)
+	{
+		vmConfig[vm] = new VM_Configuration(vm);
+		bsp::iBSP().Load_VM_Configuration(vm, *vmConfig[vm]);
+
+		vCpu[vm] = new VCpu(vmContext[vm]);
+	}
+
+	vmScheduler = new VM_Scheduler();
+	bsp::iBSP().Load_VM_Schedule(*this);
+
+	// Partition without schedule gets single window, so it owns the core if it's alone
+	for (size_t vm = 0; vm < nrVMs; vm++)
+	{
+		if (false == vmScheduler->Has_Windows(vm))
+		{
+			Add_Window(vm, _defaultWindow);
+		}
+	}
+}
+
+void VM_Manager::Add_Window(size_t vm, uint64_t duration_us)
+{
+	if (vm < nrVMs)
+	{
+		vmScheduler->Add_Window(vmConfig[vm]->VM_Get_CPU(), vm, duration_us);
+	}
+	else
+	{
+		Error() << "vmm: schedule refers to unknown VM" << vm << fmt::endl;
+	}
+}
+
+size_t VM_Manager::Cpu_Nr_VMs(size_t cpu)
+{
+	size_t ret = 0;
+
+	for (size_t vm = 0; vm < nrVMs; vm++)
+	{
+		if (vmConfig[vm]->VM_Get_CPU() == cpu)
+		{
+			ret++;
+		}
+	}
+
+	return ret;
+}
+
+void VM_Manager::Load_VM(size_t vm)
+{
+	bool wfi, wfe;
+
+	*currentVM = vm;
+
+	// Partition which owns the core could execute WFI natively, it's the lowest latency
+	if (false == vmConfig[vm]->VM_Get_Idle_Trap(wfi, wfe))
+	{
+		wfi = wfe = (Cpu_Nr_VMs(iCPU().Id()) > 1);
+	}
+
+	uint64_t hcr = ReadArm64Reg(HCR_EL2) & ~(_hcr_twi | _hcr_twe);
+	hcr |= (wfi ? _hcr_twi : 0) | (wfe ? _hcr_twe : 0);
+	WriteArm64Reg(HCR_EL2, hcr);
+
+	MMU_Switch_VM(vm);
+	Fast_Read_Switch_VM(vm);
+	vCpu[vm]->Load();
+	iVirtIC().Switch_VM(vm);
+
+	// Partitions which don't use FP/SIMD never pay for its switch
+	FP_Trap(*fpOwner != vm);
+}
+
+void VM_Manager::Unload_VM(void)
+{
+	size_t vm = *currentVM;
+
+	if (_no_vm != vm)
+	{
+		vCpu[vm]->Save();
+		iVirtIC().Switch_VM(_no_vm);
+		Fast_Read_Switch_VM(_no_vm);
+
+		*currentVM = _no_vm;
+	}
+}
+
+void VM_Manager::Wake_Cpus(void)
+{
+	size_t local = iCPU().Id();
+
+	// Target cores are waiting in idle loop, just wake them up
+	for (size_t cpu = 0; cpu < _max_cpus; cpu++)
+	{
+		if ((cpu == local) || (0 == Cpu_Nr_VMs(cpu)))
+		{
+			continue;
+		}
+
+		if (SMP_Cpu_Is_Online(cpu))
+		{
+			DInfo("vmm: hand over VM request to CPU %u", cpu);
+			SMP_Request_VM_Start(cpu);
+		}
+		else
+		if (vmScheduler->Move_Frame(cpu, local))
+		{
+			Error() << "vmm: CPU " << cpu << " is offline, start its VMs on CPU " << local << fmt::endl;
+
+			for (size_t vm = 0; vm < nrVMs; vm++)
+			{
+				if (vmConfig[vm]->VM_Get_CPU() == cpu)
+				{
+					vmConfig[vm]->VM_Set_CPU(local);
+				}
+			}
+		}
+		else
+		{
+			Error() << "vmm: CPU " << cpu << " is offline, its VMs are not started" << fmt::endl;
+		}
+	}
 }
 
 void VM_Manager::Start_VM()
 {
-	if (vmConfig && (vm_state::stopped == vmState))
+	if ((nrVMs > 0) && (vm_state::stopped == vmState))
+	{
+		Set_State(vm_state::starting);
+		nrActiveCpus = 0;
+		nrRunningCpus = 0;
+
+		Wake_Cpus();
+	}
+
+	// Each core with partitions gets here: either directly or by request from another core
+	if ((vm_state::starting == vmState) || (vm_state::running == vmState))
+	{
+		Start_Local_VMs();
+	}
+	else
+	if (vm_state::request_shutdown == vmState)
+	{
+		// Partitions were paused, so they are stopped without entering the guest
+		Stop_Local_VMs();
+	}
+	else
+	if (vm_state::paused == vmState)
+	{
+		Info() << "vmm: VMs are paused, resume or stop them first" << fmt::endl;
+	}
+}
+
+void VM_Manager::Start_Local_VMs(void)
+{
+	size_t cpu = iCPU().Id();
+	bool started = false;
+
+	for (size_t vm = 0; vm < nrVMs; vm++)
 	{
-		struct AArch64_Regs guestContext;
+		// Resumed partition continues from the saved state
+		if ((vmConfig[vm]->VM_Get_CPU() != cpu) || vCpu[vm]->Started())
+		{
+			continue;
+		}
 
-		MSet<uint8_t>(&guestContext, sizeof(guestContext), 0);
+		// Trap regions and Stage-2 mappings are created for the loaded partition
+		*currentVM = vm;
+		MMU_Switch_VM(vm);
 
-		guestContext.cpsr_el2 = 0x3c5;
-		guestContext.pc_el2 = vmConfig->VM_Get_Entry_Address();
-		guestContext.sp_el1 = vmConfig->VM_Get_Entry_Address();	// Some temporary location in VM address space
+		vCpu[vm]->Reset(vmConfig[vm]->VM_Get_Entry_Address());
+		bsp::iBSP().Prepare_OS(vm, vCpu[vm]->Regs());
 
-		bsp::iBSP().Prepare_OS(guestContext);
+		FP_Context_Reset(vmContext[vm].fp);
 
-		iVirtIC().Start_Virt_IC();
-		vmConfig->VM_Allocate_Resources();
+		iVirtIC().Start_Virt_IC(vm);
+		vmConfig[vm]->VM_Allocate_Resources();
 
 		// Start virtual devices
-		bsp::iBSP().Start_Virtual_Devices();
+		bsp::iBSP().Start_Virtual_Devices(vm);
+
+		DInfo("vmm: VM%u is ready on CPU %u", vm, cpu);
+		started = true;
+	}
+
+	*currentVM = _no_vm;
+
+	if (started)
+	{
+		Atomic_Fetch_Add(&nrActiveCpus, 1U);
+	}
+
+	Run_Local_VMs();
+}
+
+void VM_Manager::Run_Local_VMs(void)
+{
+	vcpu_exit reason = vcpu_exit::none;
 
-		// TBD: reset all EL1 registers:
-		WriteArm64Reg(sctlr_el1, 0xc50838);	// Default value collected after cold reset
+	if (_no_vm == vmScheduler->Start())
+	{
+		return;
+	}
 
-		Info() << fmt::endl << "vmm: start VM" << fmt::endl;
+	// Partition switch is done with INTs masked, they are unmasked on guest entry
+	iIC().Local_IRq_Disable();
 
-		vmState = vm_state::running;
-		Switch_EL12(&guestContext);
+	Atomic_Fetch_Add(&nrRunningCpus, 1U);
+
+	if (vm_state::starting == vmState)
+	{
+		Set_State(vm_state::running);
 	}
+
+	DInfo("vmm: run VMs on CPU %u", iCPU().Id());
+
+	while ((vcpu_exit::pause != reason) && (vcpu_exit::shutdown != reason))
+	{
+		size_t vm = vmScheduler->Current();
+
+		if (*currentVM != vm)
+		{
+			Unload_VM();
+			Load_VM(vm);
+		}
+
+		Trace(tevent::guest_enter, vm, vCpu[vm]->Regs().pc_el2);
+		reason = vCpu[vm]->Run();
+
+		if (vcpu_exit::idle == reason)
+		{
+			reason = Wait_For_IRq(vm);
+		}
+		else
+		if (vcpu_exit::yield == reason)
+		{
+			// With single partition on the core it just continues
+			vmScheduler->Yield();
+			reason = vcpu_exit::none;
+		}
+		else
+		if (vcpu_exit::fault == reason)
+		{
+			// TBD: partition could be stopped alone, but its INTs and devices are not isolated yet
+			Error() << "vmm: VM" << vm << " failed, stop all VMs" << fmt::endl;
+
+			Set_State(vm_state::request_shutdown);
+			reason = vcpu_exit::shutdown;
+		}
+	}
+
+	vmScheduler->Stop();
+	Unload_VM();
+
+	// The last core completes the pause
+	if ((1 == Atomic_Fetch_Add(&nrRunningCpus, ~0U)) && (vcpu_exit::pause == reason))
+	{
+		Set_State(vm_state::paused);
+		Info() << "vmm: all VMs paused" << fmt::endl;
+	}
+
+	if (vcpu_exit::shutdown == reason)
+	{
+		Stop_Local_VMs();
+	}
+
+	iIC().Local_IRq_Enable();
+}
+
+vcpu_exit VM_Manager::Wait_For_IRq(size_t vm)
+{
+	vcpu_exit reason = Pending_Exit();
+
+	// INTs are masked here, but pending one still wakes the core up. Then it's taken
+	// in the short unmasked window: guest INT is injected to the loaded partition and
+	// scheduler timer ends the time window.
+	// TBD: pause and shutdown requests from another core are seen on the next INT
+	while ((vcpu_exit::none == reason) && (false == iVirtIC().VM_IRq_Pending(vm)))
+	{
+		Wait_For_Interrupt();
+
+		iIC().Local_IRq_Enable();
+		iIC().Local_IRq_Disable();
+
+		reason = Pending_Exit();
+	}
+
+	return reason;
 }
 
 void VM_Manager::Stop_VM()
 {
-	if (vmConfig && (vm_state::running == vmState))
+	if (vm_state::running == vmState)
 	{
-		vmState = vm_state::request_shutdown;
+		Set_State(vm_state::request_shutdown);
 
 		Raw() << fmt::endl;
 		Info() << "vmm: request shutdown" << fmt::endl;
 	}
 	else
-	if (vmConfig && (vm_state::request_shutdown == vmState))
+	if (vm_state::paused == vmState)
+	{
+		Set_State(vm_state::request_shutdown);
+		Info() << "vmm: stop paused VMs" << fmt::endl;
+
+		Wake_Cpus();
+		Stop_Local_VMs();
+	}
+	else
+	{
+		Info() << "vmm: request to shutdown non-running VM" << fmt::endl;
+	}
+}
+
+void VM_Manager::Stop_Local_VMs(void)
+{
+	size_t cpu = iCPU().Id();
+	bool stopped = false;
+
+	for (size_t vm = 0; vm < nrVMs; vm++)
 	{
+		if ((vmConfig[vm]->VM_Get_CPU() != cpu) || (false == vCpu[vm]->Started()))
+		{
+			continue;
+		}
+
+		// Stage-2 TLB is flushed for the loaded VMID
+		*currentVM = vm;
+		MMU_Switch_VM(vm);
+
 		// Stop virtual devices
-		bsp::iBSP().Start_Virtual_Devices();
+		bsp::iBSP().Stop_Virtual_Devices(vm);
 
-		vmConfig->VM_Free_Resources();
-		iVirtIC().Stop_Virt_IC();
+		vmConfig[vm]->VM_Free_Resources();
+		iVirtIC().Stop_Virt_IC(vm);
+		vCpu[vm]->Stop();
 
-		vmState = vm_state::stopped;
-		Info() << "vmm: VM stopped" << fmt::endl;
+		// FP/SIMD registers of the stopped partition are not needed anymore
+		if (*fpOwner == vm)
+		{
+			*fpOwner = _no_vm;
+		}
 
-		// Reset stack to safe boot state
-		asm volatile("mov sp, %0" :: "r" (el2_stack_reset));
-		iIC().Local_IRq_Enable();
+		DInfo("vmm: VM%u stopped", vm);
+		stopped = true;
+	}
+
+	*currentVM = _no_vm;
 
-		apps::Applications_Start();
+	// The last core completes the shutdown (decrement of the counter)
+	if (stopped && (1 == Atomic_Fetch_Add(&nrActiveCpus, ~0U)))
+	{
+		Set_State(vm_state::stopped);
+		Info() << "vmm: all VMs stopped" << fmt::endl;
+	}
+}
+
+void VM_Manager::Pause_VM()
+{
+	if (vm_state::running == vmState)
+	{
+		Set_State(vm_state::request_pause);
+
+		Raw() << fmt::endl;
+		Info() << "vmm: request pause" << fmt::endl;
 	}
 	else
 	{
-		Info() << "vmm: request to shutdown non-running VM" << fmt::endl;
+		Info() << "vmm: request to pause non-running VM" << fmt::endl;
+	}
+}
+
+void VM_Manager::Resume_VM()
+{
+	if (vm_state::paused == vmState)
+	{
+		Set_State(vm_state::starting);
+		Info() << "vmm: resume VMs" << fmt::endl;
+
+		Wake_Cpus();
+		Start_Local_VMs();
 	}
+	else
+	{
+		Info() << "vmm: request to resume non-paused VM" << fmt::endl;
+	}
+}
+
+void VM_Manager::Set_State(vm_state state)
+{
+	Trace(tevent::vm_state, static_cast<uint64_t>(vmState), static_cast<uint64_t>(state));
+
+	vmState = state;
 }
 
 vm_state VM_Manager::Get_VM_State()
@@ -131,9 +501,78 @@ vm_state VM_Manager::Get_VM_State()
 	return vmState;
 }
 
+size_t VM_Manager::Get_Nr_VMs()
+{
+	return nrVMs;
+}
+
+size_t VM_Manager::Get_VM_CPU(size_t vm)
+{
+	return (vm < nrVMs) ? vmConfig[vm]->VM_Get_CPU() : _no_vm;
+}
+
 bool VM_Manager::Guest_IRq(uint32_t nr)
 {
-	return vmConfig->VM_Own_Interrupt(nr);
+	size_t vm = *currentVM;
+
+	return (vm < nrVMs) && vmConfig[vm]->VM_Own_Interrupt(nr);
+}
+
+vcpu_exit VM_Manager::Pending_Exit(void)
+{
+	vcpu_exit reason = vcpu_exit::none;
+
+	switch (vmState)
+	{
+	case vm_state::request_pause:
+		reason = vcpu_exit::pause;
+		break;
+	case vm_state::request_shutdown:
+		reason = vcpu_exit::shutdown;
+		break;
+	default:
+		// Time window of the partition is over
+		if (vmScheduler->Current() != *currentVM)
+		{
+			reason = vcpu_exit::preempt;
+		}
+		break;
+	}
+
+	return reason;
+}
+
+void VM_Manager::Exit_VM(struct AArch64_Regs& regs, vcpu_exit reason)
+{
+	size_t vm = *currentVM;
+
+	if (vm < nrVMs)
+	{
+		// Returns from Run() in the loop of the calling core
+		vCpu[vm]->Exit(regs, reason);
+	}
+
+	Error() << "vmm: guest exit without loaded VM" << fmt::endl;
+}
+
+void VM_Manager::Switch_FP(void)
+{
+	size_t vm = *currentVM;
+	size_t owner = *fpOwner;
+
+	// Registers could be accessed only after the trap is disabled
+	FP_Trap(false);
+
+	if ((vm < nrVMs) && (owner != vm))
+	{
+		if (_no_vm != owner)
+		{
+			FP_Save(&vmContext[owner].fp);
+		}
+
+		FP_Restore(&vmContext[vm].fp);
+		*fpOwner = vm;
+	}
 }
 
 }; // namespace core
@@ -10,36 +10,81 @@
 // CONDITIONS OF ANY KIND, either express or implied. See the License for the 
 // specific language governing permissions and limitations under the License.
 
+#include "vcpu.hpp"
 #include "vm_config.hpp"
+#include "vm_context.hpp"
+#include "vm_scheduler.hpp"
 
 #include <core/ivmm>
+#include <system>
 
 namespace saturn {
 namespace core {
 
-class VM_Manager : public IVirtualMachineManager
+class VM_Manager : public IVirtualMachineManager, public IVirtualMachineSchedule
 {
 public:
 	VM_Manager();
 	~VM_Manager();
 
+public:
+	// Per-CPU part of initialization, must be called on each core
+	void Cpu_Init(void);
+
 private:
 	void Load_Config(void);
+	size_t Cpu_Nr_VMs(size_t cpu);
+	// Send start, resume or stop request to the other cores with partitions
+	void Wake_Cpus(void);
+	// State of all the partitions is changed by any core, transitions are traced
+	void Set_State(vm_state state);
+	// Prepare partitions of the calling core and run them
+	void Start_Local_VMs(void);
+	// Run loop of the calling core, returns when partitions are paused or stopped
+	void Run_Local_VMs(void);
+	// Free resources of the partitions of the calling core
+	void Stop_Local_VMs(void);
+	// Move partition state between the context and the calling core
+	void Load_VM(size_t vm);
+	void Unload_VM(void);
+	// Partition is idle, keep the core in low-power state until it has INT or should exit
+	vcpu_exit Wait_For_IRq(size_t vm);
 
 public:
 	void Start_VM();
 	void Stop_VM();
+	void Pause_VM();
+	void Resume_VM();
 	vm_state Get_VM_State();
+	size_t Get_Nr_VMs();
+	size_t Get_VM_CPU(size_t vm);
 
 public:
 	bool Guest_IRq(uint32_t nr);
+	vcpu_exit Pending_Exit(void);
+	void Exit_VM(struct AArch64_Regs& regs, vcpu_exit reason);
+	void Switch_FP(void);
+
+// Schedule configuration interface:
+public:
+	void Add_Window(size_t vm, uint64_t duration_us);
 
 private:
 	vm_state		vmState;
+	size_t			nrVMs;
+
+	// Number of cores with started partitions, the last one completes shutdown
+	volatile uint32_t	nrActiveCpus;
+	// Number of cores in the run loop, the last one completes pause
+	volatile uint32_t	nrRunningCpus;
+
+	VM_Scheduler*		vmScheduler;
+	VM_Context		(&vmContext)[];
 
 private:
 	// TBD: could not fit heap frame
-	VM_Configuration*	vmConfig;
+	VM_Configuration*	vmConfig[_max_vms];
+	VCpu*			vCpu[_max_vms];
 };
 
 }; // namespace core
@@ -0,0 +1,172 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#include "vm_scheduler.hpp"
+
+#include <arm64/registers>
+#include <core/iconsole>
+#include <core/icpu>
+#include <core/itimer>
+#include <core/ivmm>
+#include <mops>
+#include <percpu>
+
+namespace saturn {
+namespace core {
+
+// End of the active window on each core
+static PerCpu<Timer_Event> windowTimer __percpu;
+
+// Frames are indexed by CPU core, the configuration is loaded before secondary
+// cores are started, so per-CPU area can't be used here
+static Schedule_Frame _frames[_max_cpus];
+
+VM_Scheduler::VM_Scheduler()
+	: frames(_frames)
+{
+	freq = ReadArm64Reg(CNTFRQ_EL0);
+
+	MSet<uint8_t>(_frames, sizeof(_frames), 0);
+}
+
+void VM_Scheduler::Add_Window(size_t cpu, size_t vm, uint64_t duration_us)
+{
+	if ((cpu < _max_cpus) && (duration_us > 0) && (frames[cpu].nrWindows < _maxWindows))
+	{
+		Schedule_Frame& f = frames[cpu];
+
+		f.windows[f.nrWindows].vm = vm;
+		f.windows[f.nrWindows].duration = (duration_us * freq) / 1000000;
+		f.nrWindows++;
+	}
+	else
+	{
+		Error() << "sched: failed to add window of VM" << vm << " to CPU " << cpu << " frame" << fmt::endl;
+	}
+}
+
+bool VM_Scheduler::Has_Windows(size_t vm)
+{
+	bool ret = false;
+
+	for (size_t cpu = 0; cpu < _max_cpus; cpu++)
+	{
+		for (size_t i = 0; i < frames[cpu].nrWindows; i++)
+		{
+			ret |= (frames[cpu].windows[i].vm == vm);
+		}
+	}
+
+	return ret;
+}
+
+bool VM_Scheduler::Move_Frame(size_t from, size_t to)
+{
+	bool ret = false;
+
+	if ((from < _max_cpus) && (to < _max_cpus) && (0 == frames[to].nrWindows))
+	{
+		MCopy<uint8_t>(&frames[from], &frames[to], sizeof(Schedule_Frame));
+		frames[from].nrWindows = 0;
+		ret = true;
+	}
+
+	return ret;
+}
+
+size_t VM_Scheduler::Start(void)
+{
+	Schedule_Frame& f = frames[iCPU().Id()];
+	size_t vm = _no_vm;
+
+	if (f.nrWindows > 0)
+	{
+		f.current = 0;
+		f.windowEnd = Read_Counter() + f.windows[0].duration;
+		f.donee = _no_vm;
+		f.yieldPos = 0;
+		vm = f.windows[0].vm;
+
+		windowTimer->handler = Timer_Handler;
+		windowTimer->arg = this;
+
+		iTimer().Start(*windowTimer, f.windowEnd, 0);
+	}
+
+	return vm;
+}
+
+void VM_Scheduler::Stop(void)
+{
+	iTimer().Stop(*windowTimer);
+}
+
+size_t VM_Scheduler::Current(void)
+{
+	Schedule_Frame& f = frames[iCPU().Id()];
+	size_t vm = _no_vm;
+
+	if (f.nrWindows > 0)
+	{
+		vm = (_no_vm != f.donee) ? f.donee : f.windows[f.current].vm;
+	}
+
+	return vm;
+}
+
+size_t VM_Scheduler::Yield(void)
+{
+	Schedule_Frame& f = frames[iCPU().Id()];
+	size_t runner = Current();
+
+	// Windows are walked in the frame order, so yields go round all partitions of the core
+	for (size_t i = 1; i <= f.nrWindows; i++)
+	{
+		size_t pos = (f.yieldPos + i) % f.nrWindows;
+		size_t vm = f.windows[pos].vm;
+
+		if (vm != runner)
+		{
+			f.yieldPos = pos;
+			f.donee = (vm == f.windows[f.current].vm) ? _no_vm : vm;
+			break;
+		}
+	}
+
+	return Current();
+}
+
+void VM_Scheduler::Timer_Handler(void* arg)
+{
+	Schedule_Frame& f = static_cast<VM_Scheduler*>(arg)->frames[iCPU().Id()];
+	uint64_t now = Read_Counter();
+
+	// Window end is accumulated from the frame start, so the handler latency doesn't
+	// shift the schedule. If timer was delayed for longer than a window, the missed
+	// windows are skipped.
+	do
+	{
+		f.current = (f.current + 1) % f.nrWindows;
+		f.windowEnd += f.windows[f.current].duration;
+	}
+	while (f.windowEnd <= now);
+
+	// Donation ends with the window
+	f.donee = _no_vm;
+	f.yieldPos = f.current;
+
+	// The partition is switched on exit from IRq, see iVMM().Pending_Exit()
+	iTimer().Start(*windowTimer, f.windowEnd, 0);
+}
+
+}; // namespace core
+}; // namespace saturn
@@ -0,0 +1,78 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include <basetypes>
+#include <system>
+
+namespace saturn {
+namespace core {
+
+// Maximum number of time windows in the major frame of single core
+static const size_t _maxWindows = 16;
+
+// Time window (in microseconds) of partition without explicit schedule
+static const uint64_t _defaultWindow = 10000;
+
+struct Schedule_Window
+{
+	size_t vm;
+	uint64_t duration;	// In system counter ticks
+};
+
+// Major frame of the core, it's repeated until partitions are stopped
+struct Schedule_Frame
+{
+	Schedule_Window windows[_maxWindows];
+	size_t nrWindows;
+
+	// Runtime state
+	size_t current;		// Active window
+	uint64_t windowEnd;	// Absolute end time of the active window
+
+	// Partition which got the rest of the active window by directed yield
+	size_t donee;
+	size_t yieldPos;	// Window of the donee, the next yield continues from it
+};
+
+class VM_Scheduler
+{
+public:
+	VM_Scheduler();
+
+public:
+	void Add_Window(size_t cpu, size_t vm, uint64_t duration_us);
+	bool Has_Windows(size_t vm);
+	// Move the frame of offline core, fails if the target core has own frame
+	bool Move_Frame(size_t from, size_t to);
+
+public:
+	// Start major frame on calling core, returns partition of the first window
+	size_t Start(void);
+	void Stop(void);
+	// Partition of the active window on calling core
+	size_t Current(void);
+	// Give the rest of the active window to the next partition of the frame,
+	// returns partition which runs now
+	size_t Yield(void);
+
+private:
+	static void Timer_Handler(void* arg);
+
+private:
+	Schedule_Frame (&frames)[];
+	uint64_t freq;
+};
+
+}; // namespace core
+}; // namespace saturn
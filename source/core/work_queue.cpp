@@ -0,0 +1,118 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#include "work_queue.hpp"
+
+#include <arm64/atomic>
+#include <core/idlog>
+#include <percpu>
+
+namespace saturn {
+namespace core {
+
+static PerCpu<Work_Lists> workLists __percpu;
+
+Work_Queue::Work_Queue()
+{
+	DInfo("work: deferred work queues started");
+}
+
+bool Work_Queue::Queue_Work(Work_Item& work, Work_Priority prio)
+{
+	size_t p = static_cast<size_t>(prio);
+
+	if ((p >= _nrWorkPriorities) || (nullptr == work.handler))
+	{
+		return false;
+	}
+
+	// Already queued work will see the new data as well
+	if (0 != Atomic_Swap(&work.queued, 1U))
+	{
+		return false;
+	}
+
+	volatile uint64_t* head = &workLists->head[p];
+	uint64_t item = reinterpret_cast<uint64_t>(&work);
+	uint64_t old = *head;
+	uint64_t seen;
+
+	// Could be preempted by INT handler which queues the work as well
+	do
+	{
+		seen = old;
+		work.next = reinterpret_cast<Work_Item*>(seen);
+		old = Atomic_Cas(head, seen, item);
+	}
+	while (old != seen);
+
+	return true;
+}
+
+Work_Item* Work_Queue::Take_Work(Work_Lists& lists)
+{
+	Work_Item* list = nullptr;
+
+	for (size_t p = 0; (p < _nrWorkPriorities) && (nullptr == list); p++)
+	{
+		list = reinterpret_cast<Work_Item*>(Atomic_Swap(&lists.head[p], 0ULL));
+	}
+
+	// Items are pushed to the head, so reverse the list to run them in queueing order
+	Work_Item* fifo = nullptr;
+
+	while (nullptr != list)
+	{
+		Work_Item* next = list->next;
+
+		list->next = fifo;
+		fifo = list;
+		list = next;
+	}
+
+	return fifo;
+}
+
+void Work_Queue::Run_Work(void)
+{
+	Work_Lists& lists = *workLists;
+
+	if (lists.running)
+	{
+		return;
+	}
+
+	lists.running = true;
+
+	// Higher priorities are checked again after each taken list
+	Work_Item* list = Take_Work(lists);
+
+	while (nullptr != list)
+	{
+		while (nullptr != list)
+		{
+			Work_Item* work = list;
+			list = work->next;
+
+			// Handler could queue the item again, so it's released before the call
+			Store_Release(&work->queued, 0U);
+			work->handler(work->arg);
+		}
+
+		list = Take_Work(lists);
+	}
+
+	lists.running = false;
+}
+
+}; // namespace core
+}; // namespace saturn
@@ -0,0 +1,48 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include <basetypes>
+#include <core/iwork>
+
+namespace saturn {
+namespace core {
+
+static const size_t _nrWorkPriorities = static_cast<size_t>(Work_Priority::Max);
+
+// Work is pushed to lock-free lists by INT handlers of the core, the runner takes
+// the whole list at once by atomic swap
+struct Work_Lists
+{
+	volatile uint64_t head[_nrWorkPriorities];	// Work_Item pointers
+
+	// Runner could be interrupted, so nested INT exit must not start it again
+	bool running;
+};
+
+class Work_Queue : public IWorkQueue
+{
+public:
+	Work_Queue();
+
+public:
+	bool Queue_Work(Work_Item& work, Work_Priority prio);
+	void Run_Work(void);
+
+private:
+	// Take the list of the highest priority which has work, items are in FIFO order
+	Work_Item* Take_Work(Work_Lists& lists);
+};
+
+}; // namespace core
+}; // namespace saturn
@@ -50,6 +50,12 @@ public:
 
 public:
 	void SetLevel(llevel);
+	// Output is synchronous already
+	void Flush() {};
+
+	// There is no line buffer to keep
+	void EnterIRq() {};
+	void LeaveIRq() {};
 
 private:
 	Console& SignedToStr(int64_t num, uint8_t fillSize = 0);
@@ -46,6 +46,7 @@ enum Dist_Regs
 
 IC_Core::IC_Core()
 	: IRq_Table(_IRq_Table)
+	, Stats()
 {
 	// GICv3 consists from the following logical components:
 	//
@@ -116,9 +117,12 @@ void IC_Core::Handle_IRq()
 {
 	uint32_t id = ReadICCReg(ICC_IAR1_EL1) & 0xffffff;
 
+	Stats.exceptions++;
+
 	if (id < _maxIRq)
 	{
 		IRq_Table[id](id);
+		Stats.handled++;
 	}
 	else
 	{
@@ -154,6 +158,48 @@ void IC_Core::Register_IRq_Handler(uint32_t id, IRqHandler handler)
 	}
 }
 
+void IC_Core::Set_IRq_Storm_Policy(uint64_t, uint64_t, uint32_t)
+{
+	//TBD
+}
+
+void IC_Core::Set_IRq_Rate_Limit(uint32_t, uint32_t)
+{
+	//TBD
+}
+
+const IRq_Rate* IC_Core::Get_IRq_Rate(size_t)
+{
+	// TBD: INT rate is not limited by guest
+	return nullptr;
+}
+
+const IRq_Stats& IC_Core::Get_IRq_Stats()
+{
+	return Stats;
+}
+
+const IRq_Timing* IC_Core::Get_IRq_Timing(size_t)
+{
+	// TBD: INT timings are not tracked by guest
+	return nullptr;
+}
+
+void IC_Core::Reset_IRq_Timing()
+{
+	//TBD
+}
+
+void IC_Core::Set_IRq_Budget(uint64_t)
+{
+	//TBD
+}
+
+uint64_t IC_Core::Get_IRq_Budget()
+{
+	return 0;
+}
+
 void IC_Core::Default_Handler(uint32_t id)
 {
 	Error() << "warning: received INT with ID (" << id << ") without registered handler" << fmt::endl;
@@ -169,4 +215,14 @@ void IC_Core::IRq_Disable(uint32_t)
 	//TBD
 }
 
+void IC_Core::Set_IRq_Priority(uint32_t, IRqPriority)
+{
+	//TBD
+}
+
+void IC_Core::Set_IRq_Affinity(uint32_t, size_t)
+{
+	//TBD
+}
+
 }; // namespace asteroid
@@ -30,14 +30,29 @@ public:
 	void Local_IRq_Enable();
 	void IRq_Enable(uint32_t);
 	void IRq_Disable(uint32_t);
+	void Set_IRq_Priority(uint32_t, IRqPriority);
+	void Set_IRq_Affinity(uint32_t, size_t);
 
 public:
 	void Send_SGI(uint32_t targetList, uint8_t id);
 	void Handle_IRq();
 	void Register_IRq_Handler(uint32_t, IRqHandler);
 
+public:
+	void Set_IRq_Storm_Policy(uint64_t, uint64_t, uint32_t);
+	void Set_IRq_Rate_Limit(uint32_t, uint32_t);
+	const IRq_Rate* Get_IRq_Rate(size_t);
+
+public:
+	const IRq_Stats& Get_IRq_Stats();
+	const IRq_Timing* Get_IRq_Timing(size_t);
+	void Reset_IRq_Timing();
+	void Set_IRq_Budget(uint64_t);
+	uint64_t Get_IRq_Budget();
+
 private:
 	IRqHandler (&IRq_Table)[];
+	IRq_Stats Stats;
 
 private:
 	static void Default_Handler(uint32_t);
@@ -14,6 +14,7 @@
 #include "uart_pl011.hpp"
 
 #include <arm64/registers>
+#include <hypercall>
 #include <io>
 
 using namespace saturn;
@@ -55,10 +56,74 @@ static void Timer_App(void)
 	WriteArm64Reg(CNTV_CTL_EL0, 1);
 }
 
+// Number of round trips to the hypervisor per benchmark
+static const uint64_t _benchLoops = 1000;
+
+// PL011 registers (see bsp/platform): flags are served by hypervisor fast path,
+// control register read goes through full exception frame
+static const uint64_t _uartFR = 0x09000018;
+static const uint64_t _uartCR = 0x09000030;
+
+static uint64_t Hypercall(uint64_t id)
+{
+	register uint64_t x0 asm("x0") = id;
+
+	asm volatile("hvc #0" : "+r" (x0) : : "memory");
+
+	return x0;
+}
+
+static void Exit_Hvc_Fast(void)
+{
+	Hypercall(_hvc_ping);
+}
+
+static void Exit_Hvc_Full(void)
+{
+	Hypercall(_hvc_ping_full);
+}
+
+static void Exit_Mmio_Fast(void)
+{
+	Read<uint32_t>(_uartFR);
+}
+
+static void Exit_Mmio_Full(void)
+{
+	Read<uint32_t>(_uartCR);
+}
+
+static void Exit_Bench(const char* name, void (*exit)(void))
+{
+	uint64_t freq = ReadArm64Reg(CNTFRQ_EL0);
+	uint64_t start = ReadArm64Reg(CNTVCT_EL0);
+
+	for (uint64_t i = 0; i < _benchLoops; i++)
+	{
+		exit();
+	}
+
+	uint64_t ticks = ReadArm64Reg(CNTVCT_EL0) - start;
+
+	Info() << "bench: " << name << " " << (ticks * 1000000000) / (freq * _benchLoops) << " ns per round trip ("
+	       << ticks << " ticks in " << _benchLoops << ")" << fmt::endl;
+}
+
+static void Exit_Benchmark(void)
+{
+	Exit_Bench("hvc fast ", Exit_Hvc_Fast);
+	Exit_Bench("hvc full ", Exit_Hvc_Full);
+	Exit_Bench("mmio fast", Exit_Mmio_Fast);
+	Exit_Bench("mmio full", Exit_Mmio_Full);
+}
+
 static void Demo_Application(void)
 {
 	Info() << "* start demo application *" << fmt::endl;
 
+	// Measure the cost of guest exits to hypervisor
+	Exit_Benchmark();
+
 	Timer_App();
 
 	for (;;);
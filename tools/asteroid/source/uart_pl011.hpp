@@ -31,6 +31,7 @@ public:
 public:
 	void Rx(uint8_t *buff, size_t len);
 	void Tx(uint8_t *buff, size_t len);
+	void Flush(void) {};
 	void EnableRx(void);
 	void HandleIRq(void);
 
@@ -0,0 +1,257 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#include "host.hpp"
+
+#include "core/console.hpp"
+#include "core/heap.hpp"
+
+#include <arm64/registers>
+#include <core/itrace>
+#include <core/ivmm>
+
+#include <stdio.h>
+#include <string.h>
+
+// Trace is never enabled on host
+volatile bool trace_enabled = false;
+
+// Environment of host-built components: heap and console are the real ones, the
+// rest of hypervisor is replaced by stubs
+
+namespace saturn {
+
+namespace core {
+
+static Heap* hostHeap = nullptr;
+static Console* hostConsole = nullptr;
+
+IHeap& iHeap(void)
+{
+	return *hostHeap;
+}
+
+IConsole& iConsole(void)
+{
+	return *hostConsole;
+}
+
+// Console command keys are the only users of VM manager
+class Host_VMM : public IVirtualMachineManager
+{
+public:
+	void Start_VM() {}
+	void Stop_VM() { stopRequests++; }
+	void Pause_VM() { pauseRequests++; }
+	void Resume_VM() {}
+	vm_state Get_VM_State() { return vm_state::stopped; }
+	size_t Get_Nr_VMs() { return 0; }
+	size_t Get_VM_CPU(size_t vm) { return 0; }
+	bool Guest_IRq(uint32_t nr) { return false; }
+	vcpu_exit Pending_Exit(void) { return vcpu_exit::none; }
+	void Exit_VM(struct AArch64_Regs& regs, vcpu_exit reason) {}
+	void Switch_FP(void) {}
+
+public:
+	size_t stopRequests = 0;
+	size_t pauseRequests = 0;
+};
+
+static Host_VMM hostVMM;
+
+IVirtualMachineManager& iVMM(void)
+{
+	return hostVMM;
+}
+
+size_t Current_VM(void)
+{
+	return _no_vm;
+}
+
+void Trace_Record(tevent event, uint64_t a0, uint64_t a1, uint64_t a2, uint64_t a3)
+{}
+
+}; // namespace core
+
+namespace host {
+
+// UART keeps the tail of output, it's printed to stdout in verbose mode
+class Host_Uart : public device::IUartDevice
+{
+public:
+	void Rx(uint8_t* buff, size_t len) {}
+
+	void Tx(uint8_t* buff, size_t len)
+	{
+		if (verbose)
+		{
+			fwrite(buff, 1, len, stdout);
+		}
+
+		// Only the recent output is kept, tests reset it before the check
+		if (size + len >= sizeof(data))
+		{
+			size = 0;
+		}
+
+		if (len >= sizeof(data))
+		{
+			buff += len - sizeof(data) + 1;
+			len = sizeof(data) - 1;
+		}
+
+		memcpy(data + size, buff, len);
+		size += len;
+		data[size] = 0;
+	}
+
+	void Flush(void) {}
+
+public:
+	char data[4096];
+	size_t size = 0;
+	bool verbose = false;
+};
+
+static Host_Uart hostUart;
+
+const char* Console_Output(void)
+{
+	return hostUart.data;
+}
+
+void Console_Reset(void)
+{
+	hostUart.size = 0;
+	hostUart.data[0] = 0;
+}
+
+static size_t nrFailures = 0;
+
+bool Check(bool cond, const char* expr, const char* file, int line)
+{
+	if (false == cond)
+	{
+		printf("  %s:%d: check failed: %s\n", file, line, expr);
+		nrFailures++;
+	}
+
+	return cond;
+}
+
+void Init(bool verbose)
+{
+	static core::Heap heap;
+
+	core::hostHeap = &heap;
+
+	// Console allocates its buffers, so it's created after the heap
+	static core::Console console;
+
+	core::hostConsole = &console;
+
+	hostUart.verbose = verbose;
+	console.RegisterUart(hostUart);
+	console.SetLevel(core::llevel::log);
+	Console_Reset();
+}
+
+bool Run_Tests(const Suite& suite, const char* filter)
+{
+	size_t failed = 0;
+
+	for (size_t i = 0; i < suite.nrTests; i++)
+	{
+		const Test_Case& test = suite.tests[i];
+
+		if ((nullptr != filter) && (nullptr == strstr(test.name, filter)))
+		{
+			continue;
+		}
+
+		size_t before = nrFailures;
+		test.func();
+
+		printf("test: %s %s %s\n", suite.name, test.name, (nrFailures == before) ? "PASSED" : "FAILED");
+
+		if (nrFailures != before)
+		{
+			failed++;
+		}
+	}
+
+	return 0 == failed;
+}
+
+void Run_Benches(const Suite& suite, const char* filter)
+{
+	for (size_t i = 0; i < suite.nrBenches; i++)
+	{
+		const Bench_Case& bench = suite.benches[i];
+
+		if ((nullptr != filter) && (nullptr == strstr(bench.name, filter)))
+		{
+			continue;
+		}
+
+		// Warm up caches and branch predictors, then take the best of several runs
+		// to filter out the noise of the host
+		uint64_t best = ~0ULL;
+
+		bench.func(bench.iterations / 10 + 1);
+
+		for (size_t run = 0; run < 5; run++)
+		{
+			uint64_t start = Read_Counter();
+			bench.func(bench.iterations);
+			uint64_t time = Read_Counter() - start;
+
+			if (time < best)
+			{
+				best = time;
+			}
+		}
+
+		printf("bench: %s %s %.2f ns/op %zu ops\n", suite.name, bench.name,
+		       static_cast<double>(best) / bench.iterations, bench.iterations);
+	}
+}
+
+}; // namespace host
+}; // namespace saturn
+
+// Components allocate from Saturn heap as on target
+void* operator new(saturn::size_t size) noexcept
+{
+	return saturn::core::iHeap().Alloc(size);
+}
+
+void operator delete(void* base) noexcept
+{
+	saturn::core::iHeap().Free(base);
+}
+
+void operator delete(void* base, saturn::size_t size) noexcept
+{
+	saturn::core::iHeap().Free(base);
+}
+
+void* operator new[](saturn::size_t size) noexcept
+{
+	return saturn::core::iHeap().Alloc(size);
+}
+
+void operator delete[](void* base) noexcept
+{
+	saturn::core::iHeap().Free(base);
+}
@@ -0,0 +1,75 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#pragma once
+
+#include <basetypes>
+
+// Host test framework: test cases are grouped to suites, each suite has
+// correctness tests and microbenchmarks. The output is line based to be parsed
+// by scripts:
+//
+//   test: <suite> <case> PASSED|FAILED
+//   bench: <suite> <case> <ns> ns/op <iterations> ops
+
+namespace saturn {
+namespace host {
+
+struct Test_Case
+{
+	const char* name;
+	void (*func)(void);
+};
+
+// Benchmark body executes the operation the requested number of times
+struct Bench_Case
+{
+	const char* name;
+	void (*func)(size_t iterations);
+	size_t iterations;
+};
+
+struct Suite
+{
+	const char* name;
+	const Test_Case* tests;
+	size_t nrTests;
+	const Bench_Case* benches;
+	size_t nrBenches;
+};
+
+#define HOST_SUITE(_name, _tests, _benches)					\
+	extern const saturn::host::Suite _name##_suite;				\
+	const saturn::host::Suite _name##_suite = {				\
+		#_name,								\
+		_tests, sizeof(_tests) / sizeof(_tests[0]),			\
+		_benches, sizeof(_benches) / sizeof(_benches[0])		\
+	}
+
+// Failure is reported with the location, the test case continues
+#define HOST_CHECK(_cond)	saturn::host::Check((_cond), #_cond, __FILE__, __LINE__)
+
+bool Check(bool cond, const char* expr, const char* file, int line);
+
+// Keep the value alive, so benchmark loop is not removed by compiler
+template<typename T>
+static inline void Keep(T& value)
+{
+	asm volatile("" : : "g" (&value) : "memory");
+}
+
+// Console output captured by host UART
+const char* Console_Output(void);
+void Console_Reset(void);
+
+}; // namespace host
+}; // namespace saturn
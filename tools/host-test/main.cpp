@@ -0,0 +1,113 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#include "host.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+// Host test and benchmark runner:
+//
+//   host_test [test|bench] [-s <suite>] [-f <case filter>] [-v]
+//
+// Exit code is non-zero if any test fails.
+
+namespace saturn {
+namespace host {
+
+extern const Suite lib_suite;
+extern const Suite ringbuffer_suite;
+extern const Suite heap_suite;
+extern const Suite console_suite;
+extern const Suite mmu_suite;
+
+static const Suite* _suites[] = {
+	&lib_suite,
+	&ringbuffer_suite,
+	&heap_suite,
+	&console_suite,
+	&mmu_suite
+};
+
+void Init(bool verbose);
+bool Run_Tests(const Suite& suite, const char* filter);
+void Run_Benches(const Suite& suite, const char* filter);
+
+}; // namespace host
+}; // namespace saturn
+
+int main(int argc, char* argv[])
+{
+	using namespace saturn::host;
+
+	bool bench = false;
+	bool verbose = false;
+	const char* suiteName = nullptr;
+	const char* filter = nullptr;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (0 == strcmp(argv[i], "test"))
+		{
+			bench = false;
+		}
+		else if (0 == strcmp(argv[i], "bench"))
+		{
+			bench = true;
+		}
+		else if ((0 == strcmp(argv[i], "-v")))
+		{
+			verbose = true;
+		}
+		else if ((0 == strcmp(argv[i], "-s")) && (i + 1 < argc))
+		{
+			suiteName = argv[++i];
+		}
+		else if ((0 == strcmp(argv[i], "-f")) && (i + 1 < argc))
+		{
+			filter = argv[++i];
+		}
+		else
+		{
+			printf("usage: %s [test|bench] [-s <suite>] [-f <case filter>] [-v]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	Init(verbose);
+
+	bool passed = true;
+
+	for (const Suite* suite : _suites)
+	{
+		if ((nullptr != suiteName) && (0 != strcmp(suite->name, suiteName)))
+		{
+			continue;
+		}
+
+		if (bench)
+		{
+			Run_Benches(*suite, filter);
+		}
+		else
+		{
+			passed = Run_Tests(*suite, filter) && passed;
+		}
+	}
+
+	if (false == bench)
+	{
+		printf("result: %s\n", passed ? "PASSED" : "FAILED");
+	}
+
+	return passed ? 0 : 1;
+}
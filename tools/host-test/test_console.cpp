@@ -0,0 +1,200 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#include "host.hpp"
+
+#include <core/iconsole>
+#include <core/idlog>
+
+#include "core/console.hpp"
+
+#include <string.h>
+
+namespace saturn {
+namespace host {
+
+using namespace core;
+
+static bool Output_Is(const char* expected)
+{
+	bool ret = (0 == strcmp(Console_Output(), expected));
+
+	if (false == ret)
+	{
+		HOST_CHECK(0 == strcmp(Console_Output(), expected));
+	}
+
+	Console_Reset();
+
+	return ret;
+}
+
+// Tests
+
+static void Console_Numbers(void)
+{
+	Console_Reset();
+
+	Info() << static_cast<uint32_t>(0) << " " << static_cast<int32_t>(-42) << " " << 18446744073709551615ULL
+	       << " " << fmt::hex << static_cast<uint64_t>(0xdeadbeef) << fmt::endl;
+	Output_Is("[inf] 0 -42 18446744073709551615 deadbeef\r\n");
+
+	Log() << fmt::hex << fmt::fill << static_cast<uint32_t>(0x1f) << " " << static_cast<uint64_t>(0x2a) << fmt::endl;
+	Output_Is("[log] 0000001f 000000000000002a\r\n");
+
+	// Format is reset by line break
+	Info() << static_cast<size_t>(100) << fmt::endl;
+	Output_Is("[inf] 100\r\n");
+
+	Error() << fmt::hex << static_cast<int64_t>(-1) << fmt::endl;
+	Output_Is("[err] <invalid>\r\n");
+}
+
+static void Console_Text(void)
+{
+	Console_Reset();
+
+	Info() << "a\\nb\\\\c\\q" << fmt::endl;
+	Output_Is("[inf] a\nb\\c\\q\r\n");
+
+	// Raw output is not buffered till line break
+	Raw() << "prompt> ";
+	Output_Is("prompt> ");
+	Raw() << fmt::endl;
+	Console_Reset();
+
+	// Message longer than line buffer is sent by parts, nothing is lost
+	char text[1000];
+
+	for (size_t i = 0; i < sizeof(text) - 1; i++)
+	{
+		text[i] = 'a' + (i % 26);
+	}
+
+	text[sizeof(text) - 1] = 0;
+
+	Info() << text << fmt::endl;
+
+	HOST_CHECK(strlen(Console_Output()) == 6 + strlen(text) + 2);
+	HOST_CHECK(0 == strncmp(Console_Output() + 6, text, strlen(text)));
+	Console_Reset();
+}
+
+static void Console_Level(void)
+{
+	Console_Reset();
+
+	iConsole().SetLevel(llevel::error);
+	Info() << "hidden " << 1 << fmt::endl;
+	Error() << "shown" << fmt::endl;
+	iConsole().SetLevel(llevel::log);
+
+	Output_Is("[err] shown\r\n");
+}
+
+static void Console_Nested(void)
+{
+	Console_Reset();
+
+	// INT handler preempts the message, its line is sent first and the format of
+	// interrupted message is kept
+	Info() << "outer " << fmt::hex;
+	iConsole().EnterIRq();
+	Error() << "inner " << static_cast<uint32_t>(10) << fmt::endl;
+	iConsole().LeaveIRq();
+	Info() << static_cast<uint32_t>(10) << fmt::endl;
+
+	Output_Is("[err] inner 10\r\n[inf] outer a\r\n");
+}
+
+static void Console_Input(void)
+{
+	// Unknown command key is passed to the reader with the command prefix
+	HOST_CHECK(iConsole().RxChar('a'));
+	HOST_CHECK(iConsole().RxChar(systemKeys::cmdMode));
+	HOST_CHECK(iConsole().RxChar('x'));
+
+	HOST_CHECK('a' == iConsole().GetChar(iomode::async));
+	HOST_CHECK(systemKeys::cmdMode == iConsole().GetChar(iomode::async));
+	HOST_CHECK('x' == iConsole().GetChar(iomode::async));
+	HOST_CHECK(0 == iConsole().GetChar(iomode::async));
+	HOST_CHECK(iConsole().RxFifoEmpty());
+}
+
+static void DLog_Format(void)
+{
+#ifndef DEFERRED_LOG
+	Console_Reset();
+
+	DInfo("vm %u at 0x%x: %d%% %c", 3, 0x1000, -5, 'z');
+	Output_Is("[inf] vm 3 at 0x1000: -5% z\r\n");
+#endif
+}
+
+static const Test_Case _tests[] = {
+	{"numbers",		Console_Numbers},
+	{"text",		Console_Text},
+	{"level",		Console_Level},
+	{"nested",		Console_Nested},
+	{"input",		Console_Input},
+	{"dlog_format",		DLog_Format}
+};
+
+// Benchmarks
+
+static void Line_Dec(size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		Info() << "irq: " << static_cast<uint32_t>(i) << " count " << static_cast<uint64_t>(i * 1000003) << fmt::endl;
+	}
+}
+
+static void Line_Hex(size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		Info() << "mm: map 0x" << fmt::hex << fmt::fill << static_cast<uint64_t>(i << 12) << fmt::endl;
+	}
+}
+
+static void Line_Suppressed(size_t n)
+{
+	iConsole().SetLevel(llevel::error);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		Log() << "trap: " << fmt::hex << static_cast<uint64_t>(i) << fmt::endl;
+	}
+
+	iConsole().SetLevel(llevel::log);
+}
+
+static void DLog_Line(size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		DInfo("vgic: INT %u to LR %u", i, i % 4);
+	}
+}
+
+static const Bench_Case _benches[] = {
+	{"line_dec",		Line_Dec,		200000},
+	{"line_hex",		Line_Hex,		200000},
+	{"line_suppressed",	Line_Suppressed,	1000000},
+	{"dlog_line",		DLog_Line,		200000}
+};
+
+HOST_SUITE(console, _tests, _benches);
+
+}; // namespace host
+}; // namespace saturn
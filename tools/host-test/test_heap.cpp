@@ -0,0 +1,164 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#include "host.hpp"
+
+#include "core/mm/config.hpp"
+
+#include <core/iheap>
+#include <system>
+
+namespace saturn {
+namespace host {
+
+using core::iHeap;
+
+// Tests
+
+static void Heap_Exhaust_Pages(void)
+{
+	void* pages[core::_l3_tables + 1];
+	size_t nr = 0;
+
+	while ((nr <= core::_l3_tables) && (nullptr != (pages[nr] = iHeap().Alloc(_page_size))))
+	{
+		HOST_CHECK(0 == (reinterpret_cast<uint64_t>(pages[nr]) & (_page_size - 1)));
+		nr++;
+	}
+
+	HOST_CHECK(nr > 0);
+	HOST_CHECK(nr <= core::_l3_tables);
+
+	for (size_t i = 0; i < nr; i++)
+	{
+		iHeap().Free(pages[i]);
+	}
+
+	// All the pages are back to the pool
+	for (size_t i = 0; i < nr; i++)
+	{
+		pages[i] = iHeap().Alloc(_page_size);
+		HOST_CHECK(nullptr != pages[i]);
+	}
+
+	for (size_t i = 0; i < nr; i++)
+	{
+		iHeap().Free(pages[i]);
+	}
+}
+
+static void Heap_Size_Fallback(void)
+{
+	void* blocks[_heap_size * 2];
+	size_t nr = 0;
+
+	// Small blocks are taken from the larger pools once own pool is empty
+	while ((nr < _heap_size * 2) && (nullptr != (blocks[nr] = iHeap().Alloc(16))))
+	{
+		nr++;
+	}
+
+	HOST_CHECK(_heap_size * 2 == nr);
+
+	for (size_t i = 0; i < nr; i++)
+	{
+		iHeap().Free(blocks[i]);
+	}
+}
+
+static void Heap_Invalid_Free(void)
+{
+	uint64_t local;
+	uint8_t* block = static_cast<uint8_t*>(iHeap().Alloc(48));
+
+	HOST_CHECK(nullptr != block);
+
+	// Address outside of the pools and address inside of the block are ignored
+	iHeap().Free(&local);
+	iHeap().Free(block + 8);
+
+	// Double free must not put the block to the pool twice
+	iHeap().Free(block);
+	iHeap().Free(block);
+
+	void* first = iHeap().Alloc(48);
+	void* second = iHeap().Alloc(48);
+
+	HOST_CHECK(first != second);
+
+	iHeap().Free(first);
+	iHeap().Free(second);
+}
+
+static const Test_Case _tests[] = {
+	{"exhaust_pages",	Heap_Exhaust_Pages},
+	{"size_fallback",	Heap_Size_Fallback},
+	{"invalid_free",	Heap_Invalid_Free}
+};
+
+// Benchmarks
+
+static void Alloc_Free_16(size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		iHeap().Free(iHeap().Alloc(16));
+	}
+}
+
+static void Alloc_Free_64(size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		iHeap().Free(iHeap().Alloc(64));
+	}
+}
+
+static void Alloc_Free_Page(size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		iHeap().Free(iHeap().Alloc(_page_size));
+	}
+}
+
+// All the blocks of the pool are allocated and freed in reverse order, so the
+// cost of searching the block on free is visible
+static void Alloc_Free_Pool(size_t n)
+{
+	void* blocks[_heap_size / 2];
+
+	for (size_t i = 0; i < n; i += _heap_size / 2)
+	{
+		for (size_t j = 0; j < _heap_size / 2; j++)
+		{
+			blocks[j] = iHeap().Alloc(32);
+		}
+
+		for (size_t j = _heap_size / 2; j > 0; j--)
+		{
+			iHeap().Free(blocks[j - 1]);
+		}
+	}
+}
+
+static const Bench_Case _benches[] = {
+	{"alloc_free_16",	Alloc_Free_16,		1000000},
+	{"alloc_free_64",	Alloc_Free_64,		1000000},
+	{"alloc_free_page",	Alloc_Free_Page,	1000000},
+	{"alloc_free_pool",	Alloc_Free_Pool,	1000000}
+};
+
+HOST_SUITE(heap, _tests, _benches);
+
+}; // namespace host
+}; // namespace saturn
@@ -0,0 +1,321 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#include "host.hpp"
+
+#include <bitops>
+#include <lib/bitmap>
+#include <lib/hashmap>
+#include <lib/histogram>
+#include <lib/ilist>
+#include <lib/list>
+#include <lib/vector>
+#include <mops>
+#include <system>
+
+namespace saturn {
+namespace host {
+
+// Tests
+
+static void List_Order(void)
+{
+	lib::List<int> list;
+
+	list.push_back(2);
+	list.push_back(3);
+	list.push_front(1);
+	list.remove(2);
+
+	int sum = 0;
+	for (auto it = list.begin(); it != list.end(); ++it)
+	{
+		sum = sum * 10 + *it;
+	}
+
+	HOST_CHECK(2 == list.size());
+	HOST_CHECK(13 == sum);
+
+	list.pop_front();
+	list.pop_back();
+
+	HOST_CHECK(0 == list.size());
+	HOST_CHECK(list.begin() == list.end());
+}
+
+struct Item
+{
+	lib::IList_Hook hook;
+	int val;
+};
+
+static void IList_Unlink(void)
+{
+	Item items[4] = {{lib::IList_Hook(), 1}, {lib::IList_Hook(), 2}, {lib::IList_Hook(), 3}, {lib::IList_Hook(), 4}};
+	lib::IList<Item, &Item::hook> list;
+
+	for (auto& item : items)
+	{
+		list.push_back(item);
+	}
+
+	list.remove(items[0]);
+	list.remove(items[2]);
+	list.remove(items[2]);
+
+	HOST_CHECK(2 == list.size());
+	HOST_CHECK(&items[1] == list.front());
+	HOST_CHECK(false == items[2].hook.linked());
+
+	list.push_front(items[2]);
+
+	int sum = 0;
+	for (auto it = list.begin(); it != list.end(); ++it)
+	{
+		sum = sum * 10 + it->val;
+	}
+
+	HOST_CHECK(324 == sum);
+}
+
+static void Vector_Capacity(void)
+{
+	lib::StaticVector<int, 3> vector;
+
+	HOST_CHECK(vector.push_back(1));
+	HOST_CHECK(vector.push_back(2));
+	HOST_CHECK(vector.push_back(3));
+	HOST_CHECK(false == vector.push_back(4));
+
+	vector.erase(1);
+
+	HOST_CHECK(2 == vector.size());
+	HOST_CHECK((1 == vector[0]) && (3 == vector[1]));
+}
+
+static void HashMap_Random(void)
+{
+	// Reference is a plain array indexed by key
+	static const uint32_t _keys = 256;
+	lib::HashMap<uint32_t, uint32_t, 64> map;
+	uint32_t ref[_keys] = {};
+	uint32_t seed = 1;
+	size_t nr = 0;
+
+	for (uint32_t i = 1; i < 20000; i++)
+	{
+		seed = seed * 1103515245 + 12345;
+		uint32_t key = (seed >> 16) % _keys;
+
+		if ((seed >> 8) & 1)
+		{
+			bool added = map.insert(key, i);
+
+			if (ref[key] || (nr < 64))
+			{
+				HOST_CHECK(added);
+				nr += ref[key] ? 0 : 1;
+				ref[key] = i;
+			}
+			else
+			{
+				HOST_CHECK(false == added);
+			}
+		}
+		else
+		{
+			HOST_CHECK(map.erase(key) == (0 != ref[key]));
+			nr -= ref[key] ? 1 : 0;
+			ref[key] = 0;
+		}
+
+		uint32_t* val = map.find(key);
+		HOST_CHECK((ref[key] ? (nullptr != val) && (ref[key] == *val) : (nullptr == val)));
+	}
+
+	HOST_CHECK(nr == map.size());
+}
+
+static void Bitmap_Ranges(void)
+{
+	lib::Bitmap<300> bitmap;
+
+	bitmap.set_range(62, 70);
+	bitmap.clear_range(100, 4);
+	bitmap.set(299);
+	bitmap.set(300);
+
+	HOST_CHECK(67 == bitmap.count());
+	HOST_CHECK(62 == bitmap.find_first());
+	HOST_CHECK(104 == bitmap.find_next(100));
+	HOST_CHECK(299 == bitmap.find_next(132));
+	HOST_CHECK(100 == bitmap.find_next_zero(62));
+	HOST_CHECK(300 == bitmap.find_next_zero(299));
+
+	bitmap.reset();
+
+	HOST_CHECK(bitmap.empty());
+}
+
+static void Histogram_Merge(void)
+{
+	lib::Histogram first, second, empty;
+
+	first.Add(10);
+	first.Add(1000);
+	second.Add(3);
+	second.Add(100);
+
+	first.Merge(second);
+	first.Merge(empty);
+
+	HOST_CHECK(4 == first.Count());
+	HOST_CHECK(3 == first.Min());
+	HOST_CHECK(1000 == first.Max());
+	HOST_CHECK(278 == first.Avg());
+	HOST_CHECK(1 == first.Bucket_Count(1));
+	HOST_CHECK(1 == first.Bucket_Count(6));
+
+	empty.Merge(second);
+
+	HOST_CHECK(3 == empty.Min());
+	HOST_CHECK(100 == empty.Max());
+}
+
+static void Bitops_Scan(void)
+{
+	uint32_t value = 0;
+
+	SetBit(value, 5);
+	SetBit(value, 9);
+	ClearBit(value, 5);
+
+	HOST_CHECK(9 == FirstSetBit(value));
+	HOST_CHECK(0 == FirstCleanBit(value));
+	HOST_CHECK(32 == FirstSetBit(0U));
+	HOST_CHECK(3 == FirstCleanBit(7U));
+}
+
+static void Mops_Copy(void)
+{
+	uint64_t src[16];
+	uint64_t dst[16];
+
+	MSet<uint64_t>(src, 16, 0x5a5a);
+	MSet<uint64_t>(dst, 16, 0);
+	src[15] = 1;
+	MCopy<uint64_t>(src, dst, 15);
+
+	HOST_CHECK(0x5a5a == dst[14]);
+	HOST_CHECK(0 == dst[15]);
+}
+
+static const Test_Case _tests[] = {
+	{"list_order",		List_Order},
+	{"ilist_unlink",	IList_Unlink},
+	{"vector_capacity",	Vector_Capacity},
+	{"hashmap_random",	HashMap_Random},
+	{"bitmap_ranges",	Bitmap_Ranges},
+	{"histogram_merge",	Histogram_Merge},
+	{"bitops_scan",		Bitops_Scan},
+	{"mops_copy",		Mops_Copy}
+};
+
+// Benchmarks
+
+static void List_Push_Pop(size_t n)
+{
+	lib::List<uint64_t> list;
+
+	for (size_t i = 0; i < n; i++)
+	{
+		list.push_back(i);
+		Keep(list);
+		list.pop_front();
+	}
+}
+
+static void IList_Push_Pop(size_t n)
+{
+	Item item = {lib::IList_Hook(), 0};
+	lib::IList<Item, &Item::hook> list;
+
+	for (size_t i = 0; i < n; i++)
+	{
+		list.push_back(item);
+		Keep(*list.pop_front());
+	}
+}
+
+static void HashMap_Find(size_t n)
+{
+	static lib::HashMap<uint32_t, uint32_t, 256> map;
+
+	for (uint32_t key = 0; key < 192; key++)
+	{
+		map.insert(key * 7, key);
+	}
+
+	for (size_t i = 0; i < n; i++)
+	{
+		uint32_t* val = map.find((i % 256) * 7);
+		Keep(val);
+	}
+}
+
+static void Bitops_First_Set(size_t n)
+{
+	for (size_t i = 0; i < n; i++)
+	{
+		uint32_t value = 1U << (i % 32);
+		size_t nr = FirstSetBit(value);
+		Keep(nr);
+	}
+}
+
+static void Bitmap_Find_Next(size_t n)
+{
+	static lib::Bitmap<1024> bitmap;
+
+	bitmap.set(1000);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		size_t nr = bitmap.find_next(i % 64);
+		Keep(nr);
+	}
+}
+
+static void Mops_Copy_Page(size_t n)
+{
+	static uint8_t src[_page_size];
+	static uint8_t dst[_page_size];
+
+	for (size_t i = 0; i < n; i++)
+	{
+		MCopy<uint64_t>(src, dst, _page_size / sizeof(uint64_t));
+	}
+}
+
+static const Bench_Case _benches[] = {
+	{"list_push_pop",	List_Push_Pop,		1000000},
+	{"ilist_push_pop",	IList_Push_Pop,		1000000},
+	{"hashmap_find",	HashMap_Find,		1000000},
+	{"bitops_first_set",	Bitops_First_Set,	1000000},
+	{"bitmap_find_next",	Bitmap_Find_Next,	1000000},
+	{"mops_copy_page",	Mops_Copy_Page,		100000}
+};
+
+HOST_SUITE(lib, _tests, _benches);
+
+}; // namespace host
+}; // namespace saturn
@@ -0,0 +1,192 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#include "host.hpp"
+
+#include "core/mm/mmu.hpp"
+
+#include <arm64/registers>
+#include <core/iheap>
+
+namespace saturn {
+namespace host {
+
+using namespace core;
+
+static const uint64_t _invalid = ~0ULL;
+static const uint64_t _addr_mask = 0x0000fffffffff000ULL;
+
+// Translation by the tables as MMU does it, returns the level of the last descriptor
+static uint64_t Translate(tt_desc_t* l1, uint64_t va, size_t& level, tt_desc_t& desc)
+{
+	static const size_t _shifts[] = {_l1_addr_shift, _l2_addr_shift, _l3_addr_shift};
+	tt_desc_t* table = l1;
+
+	for (level = 1; level <= 3; level++)
+	{
+		size_t shift = _shifts[level - 1];
+
+		desc = table[(va >> shift) & _ptable_size_mask];
+
+		if (0 == (desc & 1))
+		{
+			return _invalid;
+		}
+
+		// Block or page: the output address is aligned to the level granularity
+		if ((3 == level) || (0 == (desc & 2)))
+		{
+			uint64_t mask = (1ULL << shift) - 1;
+			return (desc & _addr_mask & ~mask) | (va & mask);
+		}
+
+		table = reinterpret_cast<tt_desc_t*>(desc & _addr_mask);
+	}
+
+	return _invalid;
+}
+
+// Number of pages which could be allocated for translation tables
+static size_t Free_Pages(void)
+{
+	void* pages[_l3_tables];
+	size_t nr = 0;
+
+	while ((nr < _l3_tables) && (nullptr != (pages[nr] = iHeap().Alloc(core::_page_size))))
+	{
+		nr++;
+	}
+
+	for (size_t i = 0; i < nr; i++)
+	{
+		iHeap().Free(pages[i]);
+	}
+
+	return nr;
+}
+
+static tt_desc_t _l1Table[_ptable_size] __align(core::_page_size);
+
+// Tests
+
+static void MMU_Map_Levels(void)
+{
+	MemoryManagementUnit mmu(_l1Table);
+	size_t pages = Free_Pages();
+	uint64_t flushes = tlb_flushes;
+	size_t level;
+	tt_desc_t desc;
+
+	// 1GB block, then 2MB block and two pages of the next 2MB range
+	HOST_CHECK(nullptr != mmu.MemoryMap(0x40000000, 0x80000000, BlockSize::L1_Block, MMapType::Normal));
+	HOST_CHECK(nullptr != mmu.MemoryMap(0x100000000, 0x9000000, BlockSize::L2_Block + 2 * core::_page_size, MMapType::Device));
+	HOST_CHECK(flushes + 2 == tlb_flushes);
+
+	HOST_CHECK(0x80123456 == Translate(_l1Table, 0x40123456, level, desc));
+	HOST_CHECK(1 == level);
+	HOST_CHECK(7 == ((desc >> 2) & 7));
+
+	HOST_CHECK(0x9012345 == Translate(_l1Table, 0x100012345, level, desc));
+	HOST_CHECK(2 == level);
+	HOST_CHECK(1 == ((desc >> 2) & 7));
+	// EL2 stage: AP[2:1] = b01
+	HOST_CHECK(1 == ((desc >> 6) & 3));
+
+	HOST_CHECK(0x9201abc == Translate(_l1Table, 0x100201abc, level, desc));
+	HOST_CHECK(3 == level);
+	HOST_CHECK(_invalid == Translate(_l1Table, 0x100202000, level, desc));
+
+	// L2 and L3 tables are taken from the heap
+	HOST_CHECK(pages - 2 == Free_Pages());
+
+	mmu.MemoryUnmap(0x40000000, BlockSize::L1_Block);
+	mmu.MemoryUnmap(0x100000000, BlockSize::L2_Block + 2 * core::_page_size);
+
+	HOST_CHECK(_invalid == Translate(_l1Table, 0x40123456, level, desc));
+	HOST_CHECK(_invalid == Translate(_l1Table, 0x100201abc, level, desc));
+	HOST_CHECK(pages == Free_Pages());
+}
+
+static void MMU_Stage2_Pages(void)
+{
+	MemoryManagementUnit mmu(_l1Table, MMapStage::Stage2);
+	size_t pages = Free_Pages();
+	size_t level;
+	tt_desc_t desc;
+
+	// Addresses are not aligned to each other, so only pages could be used
+	HOST_CHECK(nullptr != mmu.MemoryMap(0x8000000, 0x48001000, 16 * core::_page_size, MMapType::Normal));
+
+	for (uint64_t offset = 0; offset < 16 * core::_page_size; offset += core::_page_size)
+	{
+		HOST_CHECK(0x48001000 + offset == Translate(_l1Table, 0x8000000 + offset, level, desc));
+		HOST_CHECK(3 == level);
+	}
+
+	// Stage 2: S2AP[1:0] = b11
+	HOST_CHECK(3 == ((desc >> 6) & 3));
+
+	mmu.MemoryUnmap(0x8000000, 16 * core::_page_size);
+
+	HOST_CHECK(_invalid == Translate(_l1Table, 0x8000000, level, desc));
+	HOST_CHECK(pages == Free_Pages());
+}
+
+static const Test_Case _tests[] = {
+	{"map_levels",		MMU_Map_Levels},
+	{"stage2_pages",	MMU_Stage2_Pages}
+};
+
+// Benchmarks
+
+// Regions of 16 pages in separate 2MB ranges, operation is map and unmap of one region
+static const size_t _nrRegions = 8;
+static const size_t _regionSize = 16 * core::_page_size;
+
+static void Map_Unmap_Regions(size_t n)
+{
+	MemoryManagementUnit mmu(_l1Table, MMapStage::Stage2);
+
+	for (size_t i = 0; i < n; i += _nrRegions)
+	{
+		for (size_t r = 0; r < _nrRegions; r++)
+		{
+			mmu.MemoryMap(0x40000000 + r * BlockSize::L2_Block, 0x80000000 + r * _regionSize, _regionSize, MMapType::Normal);
+		}
+
+		for (size_t r = 0; r < _nrRegions; r++)
+		{
+			mmu.MemoryUnmap(0x40000000 + r * BlockSize::L2_Block, _regionSize);
+		}
+	}
+}
+
+static void Map_Unmap_Block(size_t n)
+{
+	MemoryManagementUnit mmu(_l1Table, MMapStage::Stage2);
+
+	for (size_t i = 0; i < n; i++)
+	{
+		mmu.MemoryMap(0x40000000, 0x80000000, BlockSize::L2_Block, MMapType::Normal);
+		mmu.MemoryUnmap(0x40000000, BlockSize::L2_Block);
+	}
+}
+
+static const Bench_Case _benches[] = {
+	{"map_unmap_region",	Map_Unmap_Regions,	10000},
+	{"map_unmap_2m_block",	Map_Unmap_Block,	10000}
+};
+
+HOST_SUITE(mmu, _tests, _benches);
+
+}; // namespace host
+}; // namespace saturn
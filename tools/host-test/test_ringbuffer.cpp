@@ -0,0 +1,233 @@
+// Copyright (C) 2023 Alexander Smirnov <alex.bluesman.smirnov@gmail.com>
+//
+// Licensed under the MIT License (the "License"); you may not use this file except
+// in compliance with the License. You may obtain a copy of the License at
+//
+// http://opensource.org/licenses/MIT
+//
+// Unless required by applicable law or agreed to in writing, software distributed 
+// under the License is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR 
+// CONDITIONS OF ANY KIND, either express or implied. See the License for the 
+// specific language governing permissions and limitations under the License.
+
+#include "host.hpp"
+
+#include <ringbuffer>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace saturn {
+namespace host {
+
+static const size_t _ringSize = 64;
+
+// Tests
+
+static void Ring_Ignore_Full(void)
+{
+	RingBuffer<uint32_t, 8> ring(rb::full_ignore);
+	uint32_t data[12];
+	uint32_t out[12];
+
+	for (uint32_t i = 0; i < 12; i++)
+	{
+		data[i] = i;
+	}
+
+	HOST_CHECK(5 == ring.In(data, 5));
+	HOST_CHECK(3 == ring.Out(out, 3));
+	// Bulk copy wraps around the end of the buffer
+	HOST_CHECK(6 == ring.In(data + 5, 7));
+	HOST_CHECK(false == ring.In(data[11]));
+	HOST_CHECK(8 == ring.Out(out, 12));
+	HOST_CHECK((3 == out[0]) && (10 == out[7]));
+	HOST_CHECK(ring.Empty());
+}
+
+static void Ring_Overwrite(void)
+{
+	// Size is not power of 2, so position is wrapped by division
+	static char buf[6];
+	RingBuffer<char, 6> ring(rb::full_overwrite, buf);
+	char out[8] = {};
+
+	HOST_CHECK(4 == ring.In("abcd", 4));
+	HOST_CHECK(5 == ring.In("efghi", 5));
+	HOST_CHECK(6 == ring.Out(out, 8));
+	HOST_CHECK(0 == __builtin_memcmp(out, "defghi", 6));
+
+	HOST_CHECK(9 == ring.In("123456789", 9));
+	HOST_CHECK(6 == ring.Out(out, 8));
+	HOST_CHECK(0 == __builtin_memcmp(out, "456789", 6));
+}
+
+static void SPSC_Wrap(void)
+{
+	static uint64_t buf[8];
+	SPSC_RingBuffer<uint64_t, 8> ring(buf);
+	uint64_t next = 0;
+	uint64_t expected = 0;
+
+	// Free running counters pass the buffer size many times
+	for (size_t round = 0; round < 100; round++)
+	{
+		uint64_t data[5];
+		uint64_t out[5];
+
+		for (size_t i = 0; i < 5; i++)
+		{
+			data[i] = next++;
+		}
+
+		HOST_CHECK(5 == ring.In(data, 5));
+		HOST_CHECK(5 == ring.Out(out, 5));
+		HOST_CHECK((expected == out[0]) && (expected + 4 == out[4]));
+		expected += 5;
+	}
+
+	HOST_CHECK(ring.Empty());
+}
+
+// Producer and consumer run on different host threads
+struct SPSC_Threads
+{
+	SPSC_RingBuffer<uint64_t, _ringSize>* ring;
+	uint64_t count;
+	bool ordered;
+};
+
+static void* SPSC_Producer(void* arg)
+{
+	SPSC_Threads* ctx = static_cast<SPSC_Threads*>(arg);
+
+	for (uint64_t i = 0; i < ctx->count; )
+	{
+		if (ctx->ring->In(i))
+		{
+			i++;
+		}
+		else
+		{
+			// Build host could have a single core, so let another side run
+			sched_yield();
+		}
+	}
+
+	return nullptr;
+}
+
+static void SPSC_Consume(SPSC_Threads& ctx)
+{
+	uint64_t chunk[16];
+
+	for (uint64_t i = 0; i < ctx.count; )
+	{
+		size_t n = ctx.ring->Out(chunk, 16);
+
+		for (size_t j = 0; j < n; j++, i++)
+		{
+			if (chunk[j] != i)
+			{
+				ctx.ordered = false;
+			}
+		}
+
+		if (0 == n)
+		{
+			// Build host could have a single core, so let another side run
+			sched_yield();
+		}
+	}
+}
+
+static void SPSC_Run_Threads(uint64_t count, bool& ordered)
+{
+	static uint64_t buf[_ringSize];
+	SPSC_RingBuffer<uint64_t, _ringSize> ring(buf);
+	SPSC_Threads ctx = {&ring, count, true};
+	pthread_t producer;
+
+	pthread_create(&producer, nullptr, SPSC_Producer, &ctx);
+	SPSC_Consume(ctx);
+	pthread_join(producer, nullptr);
+
+	ordered = ctx.ordered && ring.Empty();
+}
+
+static void SPSC_Two_Threads(void)
+{
+	bool ordered;
+
+	SPSC_Run_Threads(1000000, ordered);
+
+	HOST_CHECK(ordered);
+}
+
+static const Test_Case _tests[] = {
+	{"ring_ignore_full",	Ring_Ignore_Full},
+	{"ring_overwrite",	Ring_Overwrite},
+	{"spsc_wrap",		SPSC_Wrap},
+	{"spsc_two_threads",	SPSC_Two_Threads}
+};
+
+// Benchmarks
+
+static void Ring_In_Out(size_t n)
+{
+	static char buf[_page_size];
+	static RingBuffer<char, _page_size> ring(rb::full_ignore, buf);
+	char c = 0;
+
+	for (size_t i = 0; i < n; i++)
+	{
+		ring.In(c);
+		ring.Out(c);
+	}
+}
+
+static void Ring_In_Out_Bulk(size_t n)
+{
+	static char buf[_page_size];
+	static RingBuffer<char, _page_size> ring(rb::full_ignore, buf);
+	char chunk[_ringSize];
+
+	// Operation is a single element, so the result is comparable with the loop above
+	for (size_t i = 0; i < n; i += _ringSize)
+	{
+		ring.In(chunk, _ringSize);
+		ring.Out(chunk, _ringSize);
+	}
+}
+
+static void SPSC_In_Out(size_t n)
+{
+	static char buf[_page_size];
+	static SPSC_RingBuffer<char, _page_size> ring(buf);
+	char c = 0;
+
+	for (size_t i = 0; i < n; i++)
+	{
+		ring.In(c);
+		ring.Out(c);
+	}
+}
+
+static void SPSC_Threads_Transfer(size_t n)
+{
+	bool ordered;
+
+	SPSC_Run_Threads(n, ordered);
+}
+
+static const Bench_Case _benches[] = {
+	{"ring_in_out",		Ring_In_Out,		1000000},
+	{"ring_in_out_bulk",	Ring_In_Out_Bulk,	1000000},
+	{"spsc_in_out",		SPSC_In_Out,		1000000},
+	{"spsc_two_threads",	SPSC_Threads_Transfer,	1000000}
+};
+
+HOST_SUITE(ringbuffer, _tests, _benches);
+
+}; // namespace host
+}; // namespace saturn